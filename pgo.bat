@@ -0,0 +1,45 @@
+@echo off
+rem Profile-guided build of the game with MSVC, the steps of "Profile-guided build" in README.md:
+rem release build, workload report, instrumented build, training, PGO build and workload compared with the release.
+rem Run from a Visual Studio developer command prompt. SDL2_INCLUDE and SDL2_LIB are the directories with headers and
+rem import libraries of SDL2, SDL2_image and SDL2_ttf. Binaries, profiles and reports are written to pgo-build;
+rem the game runs from this directory, which contains gamedata and the SDL DLLs.
+setlocal enabledelayedexpansion
+cd /d "%~dp0"
+
+if "%SDL2_INCLUDE%"=="" goto usage
+if "%SDL2_LIB%"=="" goto usage
+
+set OUT=pgo-build
+rem Tools have their own main()
+set SOURCES=
+for %%f in (source\*.cpp) do (
+	if /i not "%%~nf"=="telemetry_reader" if /i not "%%~nf"=="embed_levels" set SOURCES=!SOURCES! %%f
+)
+rem LINK itself is read by link.exe as extra options, so libraries get another name
+set LIBRARIES=/LIBPATH:"%SDL2_LIB%" SDL2.lib SDL2main.lib SDL2_image.lib SDL2_ttf.lib /SUBSYSTEM:CONSOLE
+
+if exist %OUT% rmdir /s /q %OUT%
+mkdir %OUT%\obj
+mkdir %OUT%\release
+
+echo Building release...
+rem Objects compiled with /GL are linked by all three builds; /LTCG optimizes them at link time
+cl /nologo /O2 /GL /EHsc /MD /std:c++17 /DNDEBUG /I"%SDL2_INCLUDE%" /c %SOURCES% /Fo%OUT%\obj\ || exit /b 1
+link /nologo /LTCG %OUT%\obj\*.obj %LIBRARIES% /OUT:%OUT%\release\ballgame.exe || exit /b 1
+%OUT%\release\ballgame.exe --workload %OUT%\release.txt || exit /b 1
+
+echo Building instrumented binary and training it...
+rem Training runs write ballgame!N.pgc next to ballgame.pgd, which /USEPROFILE merges
+link /nologo /LTCG /GENPROFILE %OUT%\obj\*.obj %LIBRARIES% /OUT:%OUT%\ballgame.exe || exit /b 1
+%OUT%\ballgame.exe --workload || exit /b 1
+%OUT%\ballgame.exe --simulate 200000 --autopilot || exit /b 1
+
+echo Building with the profile...
+link /nologo /LTCG /USEPROFILE %OUT%\obj\*.obj %LIBRARIES% /OUT:%OUT%\ballgame.exe || exit /b 1
+%OUT%\ballgame.exe --workload %OUT%\pgo.txt --baseline %OUT%\release.txt
+exit /b %errorlevel%
+
+:usage
+echo Set SDL2_INCLUDE and SDL2_LIB to the include and library directories of SDL2, SDL2_image and SDL2_ttf.
+exit /b 1
@@ -0,0 +1,57 @@
+#!/bin/sh
+# Profile-guided build of the game with GCC or Clang, the steps of "Profile-guided build" in README.md:
+# release build, workload report, instrumented build, training, PGO build and workload compared with the release.
+# CXX selects the compiler (g++ by default). SDL_CFLAGS and SDL_LIBS default to sdl2-config with SDL2_image and SDL2_ttf.
+# Binaries, profiles and reports are written to pgo-build; the game runs from this directory, which contains gamedata.
+set -e
+cd "$(dirname "$0")"
+
+CXX=${CXX:-g++}
+if [ -z "$SDL_CFLAGS" ]; then SDL_CFLAGS=$(sdl2-config --cflags); fi
+if [ -z "$SDL_LIBS" ]; then SDL_LIBS="$(sdl2-config --libs) -lSDL2_image -lSDL2_ttf"; fi
+OUT=pgo-build
+FLAGS="-std=c++17 -O2 -flto -DNDEBUG -pthread"
+# Tools have their own main()
+SOURCES=$(ls source/*.cpp | grep -v -e telemetry_reader.cpp -e embed_levels.cpp)
+
+# Clang writes raw profiles that have to be merged by llvm-profdata, GCC reads its own directly
+if $CXX --version | grep -q clang; then
+	GENERATE="-fprofile-generate=$OUT/profile"
+	USE="-fprofile-use=$OUT/game.profdata"
+else
+	# The game runs several threads, so counters are updated atomically
+	GENERATE="-fprofile-generate=$OUT/profile -fprofile-update=atomic"
+	USE="-fprofile-use=$OUT/profile -Wno-missing-profile"
+fi
+
+# Compiles every source with given flags into objects of fixed names, which GCC matches profiles by, and links binary $1
+build()
+{
+	name=$1
+	shift
+	mkdir -p "$OUT/obj"
+	for source in $SOURCES; do
+		$CXX $FLAGS "$@" $SDL_CFLAGS -c "$source" -o "$OUT/obj/$(basename "$source" .cpp).o"
+	done
+	$CXX $FLAGS "$@" "$OUT"/obj/*.o -o "$OUT/$name" $SDL_LIBS
+	rm -rf "$OUT/obj"
+}
+
+rm -rf "$OUT"
+mkdir -p "$OUT"
+
+echo "Building release..."
+build ballgame-release
+"$OUT/ballgame-release" --workload "$OUT/release.txt"
+
+echo "Building instrumented binary and training it..."
+build ballgame-instrumented $GENERATE
+"$OUT/ballgame-instrumented" --workload
+"$OUT/ballgame-instrumented" --simulate 200000 --autopilot
+if $CXX --version | grep -q clang; then
+	${LLVM_PROFDATA:-llvm-profdata} merge -o "$OUT/game.profdata" "$OUT"/profile/*.profraw
+fi
+
+echo "Building with the profile..."
+build ballgame-pgo $USE
+"$OUT/ballgame-pgo" --workload "$OUT/pgo.txt" --baseline "$OUT/release.txt"
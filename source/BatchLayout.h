@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ballgame
+{
+	//Action of one environment in a step, the same as the keys of the player.
+	enum class BatchAction : uint8_t
+	{
+		None = 0,
+		Left = 1,
+		Right = 2,
+		//Switches the racket between changing x-speed and y-speed of the ball.
+		Focus = 3
+	};
+
+	//Index of every value of an observation. Block resistances follow, in the order of the level pattern.
+	enum BatchObservation : uint32_t
+	{
+		ObservationBallX,
+		ObservationBallY,
+		ObservationBallVx,
+		ObservationBallVy,
+		ObservationRacketPos,
+		ObservationRacketWidth,
+		ObservationLevel,
+		ObservationHealth,
+		ObservationPoints,
+		//1 if the racket changes x-speed of the ball, 0 for y-speed.
+		ObservationFocusX,
+		ObservationBlocks
+	};
+
+	//Magic number opening a batch buffer ("BGBA").
+	const uint32_t batchMagic = 0x41424742;
+	const uint32_t batchVersion = 1;
+
+	/**
+	Header at the start of a batch buffer, followed by the arrays of all environments.
+	The buffer holds offsets instead of pointers, so it can be placed in shared memory and read in place by other processes.
+	**/
+	struct BatchHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t envCount;
+		//int32 values of one observation: ObservationBlocks plus blocks of the largest level, unused blocks are 0.
+		uint32_t observationSize;
+		//Offsets of the arrays from the start of the buffer.
+		//uint8 BatchAction[envCount], written before a step.
+		uint64_t actionsOffset;
+		//int32[envCount][observationSize]
+		uint64_t observationsOffset;
+		//float[envCount], points gained in the step; losing a life costs 10.
+		uint64_t rewardsOffset;
+		//uint8[envCount], 1 if the game was won or lost in the step and restarted.
+		uint64_t doneOffset;
+		/**
+		Steps taken, increased after all results of a step are written. It is stored with release ordering,
+		so a reader in another thread or process must load it with acquire ordering before reading the results.
+		**/
+		std::atomic<uint64_t> steps;
+	};
+	static_assert(sizeof(BatchHeader) == 56, "batch header layout changed");
+	//Readers in other processes see the counter as a plain aligned uint64.
+	static_assert(std::atomic<uint64_t>::is_always_lock_free && sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "step counter must be a lock-free uint64");
+
+	//Every array starts on its own cache line.
+	const uint64_t batchAlignment = 64;
+
+	//Rounds offset up to batchAlignment.
+	inline uint64_t alignBatchOffset(uint64_t offset)
+	{
+		return (offset + batchAlignment - 1) / batchAlignment * batchAlignment;
+	}
+
+	//Fills header for given environments and returns size of the whole buffer in bytes.
+	inline size_t layoutBatchBuffer(BatchHeader& header, uint32_t envCount, uint32_t observationSize)
+	{
+		header.magic = batchMagic;
+		header.version = batchVersion;
+		header.envCount = envCount;
+		header.observationSize = observationSize;
+		header.actionsOffset = alignBatchOffset(sizeof(BatchHeader));
+		header.observationsOffset = alignBatchOffset(header.actionsOffset + envCount);
+		header.rewardsOffset = alignBatchOffset(header.observationsOffset + uint64_t(envCount) * observationSize * sizeof(int32_t));
+		header.doneOffset = alignBatchOffset(header.rewardsOffset + uint64_t(envCount) * sizeof(float));
+		header.steps.store(0, std::memory_order_relaxed);
+		return static_cast<size_t>(alignBatchOffset(header.doneOffset + envCount));
+	}
+
+	//Returns array at given offset of the buffer starting with header.
+	template <typename T>
+	T* batchArray(BatchHeader* header, uint64_t offset)
+	{
+		return reinterpret_cast<T*>(reinterpret_cast<char*>(header) + offset);
+	}
+}
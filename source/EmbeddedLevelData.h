@@ -0,0 +1,43 @@
+#pragma once
+//Generated by embed_levels from gamedata/levels.txt and gamedata/levels/levelN.txt, do not edit. See EmbeddedLevels.h.
+
+namespace ballgame
+{
+	namespace embedded
+	{
+		//Copy of gamedata/levels.txt
+		constexpr const char levelData[] = R"(
+1_2_200_0_5_14_
+2_3_190_2_7_15_
+3_3_150_1_4_20_
+4_5_120_0_5_16_)";
+
+		//Copies of gamedata/levels/levelN.txt
+		constexpr const char* levelPatterns[] = {
+			R"(
+1_1_1_1_1_1_1_1_1_1_
+2_0_0_1_1_1_0_0_0_2_
+0_0_0_0_0_0_0_0_0_0_
+0_0_0_0_0_0_0_0_0_0_
+0_0_0_0_0_0_0_0_0_0_)",
+			R"(
+3_3_3_3_1_1_1_3_3_2_
+1_2_1_2_1_2_1_2_1_2_
+3_1_1_1_1_1_1_1_1_3_
+0_0_0_0_0_0_0_0_0_0_
+0_0_0_0_0_0_0_0_0_0_)",
+			R"(
+4_1_1_1_4_1_1_1_1_4_
+3_3_2_2_2_2_2_2_3_3_
+1_2_3_4_0_0_4_3_2_1_
+0_0_0_0_0_0_0_0_0_0_
+0_0_0_0_0_0_0_0_0_0_)",
+			R"(
+1_3_3_4_4_4_4_3_3_1_
+2_0_5_5_1_5_0_5_0_2_
+2_1_4_3_5_3_4_2_1_2_
+0_1_1_2_1_2_1_2_1_0_
+3_3_3_2_2_2_2_3_3_3_)"
+		};
+	}
+}
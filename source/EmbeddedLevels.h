@@ -0,0 +1,136 @@
+#pragma once
+/**
+Level data compiled into the executable for builds with BALLGAME_EMBEDDED_LEVELS defined.
+Texts of gamedata/levels.txt and gamedata/levels/levelN.txt are written into EmbeddedLevelData.h by embed_levels.
+They are parsed by constexpr functions, so a malformed level stops the compilation.
+**/
+#include "EmbeddedLevelData.h"
+
+namespace ballgame
+{
+	namespace embedded
+	{
+		//Maximum number of embedded levels.
+		const int maxLevels = 4;
+		//Maximum number of block rows of embedded level.
+		const int maxRows = 20;
+		//Maximum number of block columns of embedded level.
+		const int maxColumns = 20;
+
+		//Block pattern of single level.
+		struct LevelPattern
+		{
+			int rows = 0;
+			int columns = 0;
+			//Starting resistance of every block, row after row.
+			int resistances[maxRows * maxColumns] = {};
+		};
+
+		//All embedded level data, laid out like the arrays filled from files.
+		struct LevelTables
+		{
+			int count = 0;
+			//Same values as rawleveldata: id, rows, racket width, x-velocity, y-velocity, max velocity.
+			int info[maxLevels][6] = {};
+			LevelPattern patterns[maxLevels];
+		};
+
+		constexpr bool isLineBreak(char c)
+		{
+			return c == '\n' || c == '\r';
+		}
+
+		//Reads '_'-terminated integer starting at pos and moves pos after the separator.
+		constexpr int parseNumber(const char* text, int& pos)
+		{
+			bool negative = false;
+			if (text[pos] == '-')
+			{
+				negative = true;
+				pos++;
+			}
+			if (text[pos] < '0' || text[pos] > '9') throw "embedded level: expected number";
+			int number = 0;
+			while (text[pos] >= '0' && text[pos] <= '9')
+			{
+				number = number * 10 + (text[pos] - '0');
+				pos++;
+			}
+			if (text[pos] != '_') throw "embedded level: expected '_' after number";
+			pos++;
+			return negative ? -number : number;
+		}
+
+		//Parses single level pattern: rows of resistances 0-5 of equal length.
+		constexpr LevelPattern parsePattern(const char* text)
+		{
+			LevelPattern pattern;
+			int pos = 0;
+			while (text[pos] != '\0')
+			{
+				if (isLineBreak(text[pos]))
+				{
+					pos++;
+					continue;
+				}
+				if (pattern.rows == maxRows) throw "embedded level: too many rows";
+				int columns = 0;
+				while (text[pos] != '\0' && !isLineBreak(text[pos]))
+				{
+					if (columns == maxColumns) throw "embedded level: too many columns";
+					int resistance = parseNumber(text, pos);
+					if (resistance < 0 || resistance > 5) throw "embedded level: resistance out of range";
+					pattern.resistances[pattern.rows * maxColumns + columns] = resistance;
+					columns++;
+				}
+				if (pattern.rows == 0) pattern.columns = columns;
+				else if (columns != pattern.columns) throw "embedded level: rows of different length";
+				pattern.rows++;
+			}
+			if (pattern.rows == 0) throw "embedded level: empty pattern";
+			//Pack rows tightly, as Level::pattern stores them
+			for (int row = 1; row < pattern.rows; row++)
+			{
+				for (int column = 0; column < pattern.columns; column++)
+				{
+					pattern.resistances[row * pattern.columns + column] = pattern.resistances[row * maxColumns + column];
+				}
+			}
+			return pattern;
+		}
+
+		//Parses general level data and patterns of every level listed in it.
+		constexpr LevelTables parseLevels(const char* data, const char* const* patterns, int patternCount)
+		{
+			LevelTables tables;
+			int pos = 0;
+			while (data[pos] != '\0')
+			{
+				if (isLineBreak(data[pos]))
+				{
+					pos++;
+					continue;
+				}
+				if (tables.count == maxLevels) throw "embedded level: too many levels";
+				for (int property = 0; property < 6; property++)
+				{
+					if (data[pos] == '\0' || isLineBreak(data[pos])) throw "embedded level: missing level property";
+					tables.info[tables.count][property] = parseNumber(data, pos);
+				}
+				if (data[pos] != '\0' && !isLineBreak(data[pos])) throw "embedded level: too many level properties";
+				if (tables.info[tables.count][0] != tables.count + 1) throw "embedded level: levels out of order";
+				tables.count++;
+			}
+			if (tables.count != patternCount) throw "embedded level: number of patterns differs from level data";
+			for (int i = 0; i < patternCount; i++)
+			{
+				tables.patterns[i] = parsePattern(patterns[i]);
+			}
+			return tables;
+		}
+
+		//Tables parsed during compilation.
+		constexpr LevelTables levelTables = parseLevels(levelData, levelPatterns, sizeof(levelPatterns) / sizeof(levelPatterns[0]));
+		static_assert(levelTables.count == maxLevels, "game expects 4 levels");
+	}
+}
@@ -0,0 +1,101 @@
+#include "EventWaiter.h"
+#include <algorithm>
+#include <chrono>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+using namespace std;
+using namespace ballgame;
+
+EventWaiter::EventWaiter()
+{
+}
+
+EventWaiter::~EventWaiter()
+{
+	destroy();
+}
+
+bool EventWaiter::create()
+{
+	destroy();
+#ifdef _WIN32
+	wakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (wakeEvent == NULL) return false;
+#endif
+	owner = SDL_ThreadID();
+	SDL_AddEventWatch(onEvent, this);
+	created = true;
+	return true;
+}
+
+void EventWaiter::destroy()
+{
+	if (!created) return;
+	SDL_DelEventWatch(onEvent, this);
+#ifdef _WIN32
+	CloseHandle(wakeEvent);
+	wakeEvent = NULL;
+#endif
+	created = false;
+}
+
+bool EventWaiter::wait(SDL_Event& e, int timeout)
+{
+	//Without the wake signal fall back to the polling wait of SDL
+	if (!created) return SDL_WaitEventTimeout(&e, timeout) != 0;
+	const chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout);
+	while (true)
+	{
+		if (SDL_PollEvent(&e)) return true;
+		if (woken.exchange(false)) return false;
+		long long left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+		if (left <= 0) return false;
+		block(static_cast<int>(left));
+		wakeups.fetch_add(1, memory_order_relaxed);
+	}
+}
+
+void EventWaiter::wake()
+{
+	woken = true;
+	signal();
+}
+
+unsigned long long EventWaiter::getWakeups()
+{
+	return wakeups.load(memory_order_relaxed);
+}
+
+int SDLCALL EventWaiter::onEvent(void* userdata, SDL_Event*)
+{
+	EventWaiter* waiter = static_cast<EventWaiter*>(userdata);
+	//Events the waiting thread pumps itself are taken by its next poll; signalling them would only end the next block early
+	if (SDL_ThreadID() != waiter->owner) waiter->signal();
+	return 0;
+}
+
+void EventWaiter::block(int timeout)
+{
+#ifdef _WIN32
+	//Input available means messages not yet removed by SDL_PumpEvents, so none is missed between the poll and the wait
+	MsgWaitForMultipleObjectsEx(1, &wakeEvent, static_cast<DWORD>(timeout), QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+#else
+	unique_lock<mutex> lock(signalMutex);
+	signalled.wait_for(lock, chrono::milliseconds(min(timeout, pollInterval)), [this]() { return signalPending; });
+	signalPending = false;
+#endif
+}
+
+void EventWaiter::signal()
+{
+#ifdef _WIN32
+	SetEvent(wakeEvent);
+#else
+	{
+		lock_guard<mutex> lock(signalMutex);
+		signalPending = true;
+	}
+	signalled.notify_one();
+#endif
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <SDL.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace ballgame
+{
+	/**
+	Blocks the thread owning the window until input arrives or another thread wakes it.
+	SDL 2.0.10 implements SDL_WaitEventTimeout as SDL_PumpEvents and SDL_Delay(10) in a loop, so a thread waiting in it
+	still wakes 100 times a second. On Windows the wait blocks in MsgWaitForMultipleObjectsEx until a window message
+	arrives or wake() is called. Elsewhere input reaches the SDL queue only when the waiting thread pumps it, so the wait
+	blocks on a condition variable, signalled by wake() and by events pushed from other threads, for at most pollInterval ms.
+	**/
+	class EventWaiter
+	{
+	public:
+		//Longest time a wait sleeps without pumping events where window messages cannot be waited for, in ms.
+		static constexpr int pollInterval = 50;
+
+		EventWaiter();
+		~EventWaiter();
+
+		EventWaiter(const EventWaiter&) = delete;
+		EventWaiter& operator=(const EventWaiter&) = delete;
+
+		//Creates the wake signal and watches events pushed by other threads. Called on the thread owning the window after SDL_Init, which then waits. Returns false on failure.
+		bool create();
+		//Stops watching events and destroys the wake signal.
+		void destroy();
+
+		//Takes the next event, blocking until one is queued, wake() is called or timeout ms pass. Returns false if there is none.
+		bool wait(SDL_Event& e, int timeout);
+		//Ends the current or the next wait. Safe to call from any thread.
+		void wake();
+
+		//Returns how many times the waiting thread woke from blocking.
+		unsigned long long getWakeups();
+
+	private:
+		//Event watch ending the wait when a thread other than the owner pushes an event.
+		static int SDLCALL onEvent(void* userdata, SDL_Event* event);
+		//Blocks until signalled or timeout ms pass.
+		void block(int timeout);
+		//Ends the block without ending the wait.
+		void signal();
+
+		//Set by wake(), so the wait returns even without an event.
+		std::atomic<bool> woken{ false };
+		std::atomic<unsigned long long> wakeups{ 0 };
+		bool created = false;
+		//Thread that called create() and waits; set before other threads may push events.
+		SDL_threadID owner = 0;
+#ifdef _WIN32
+		//Auto-reset event handle; void* keeps windows.h out of the header.
+		void* wakeEvent = NULL;
+#else
+		std::mutex signalMutex;
+		std::condition_variable signalled;
+		bool signalPending = false;
+#endif
+	};
+}
@@ -28,6 +28,34 @@ LTexture::~LTexture()
 	free();
 }
 
+LTexture::LTexture(LTexture&& other) noexcept
+{
+	//Take over the texture, leaving the source empty
+	mTexture = other.mTexture;
+	mWidth = other.mWidth;
+	mHeight = other.mHeight;
+	filePath = std::move(other.filePath);
+	other.mTexture = NULL;
+	other.mWidth = 0;
+	other.mHeight = 0;
+}
+
+LTexture& LTexture::operator=(LTexture&& other) noexcept
+{
+	if (this != &other)
+	{
+		free();
+		mTexture = other.mTexture;
+		mWidth = other.mWidth;
+		mHeight = other.mHeight;
+		filePath = std::move(other.filePath);
+		other.mTexture = NULL;
+		other.mWidth = 0;
+		other.mHeight = 0;
+	}
+	return *this;
+}
+
 void LTexture::free()
 {
 	//Free texture if it exists
@@ -0,0 +1,46 @@
+#pragma once
+#include <SDL.h>
+#include <string>
+
+namespace ballgame
+{
+	/**
+	Texture wrapper owning a single SDL_Texture.
+	It is move-only: copying would make two objects destroy the same texture.
+	**/
+	class LTexture
+	{
+	public:
+		LTexture();
+		LTexture(std::string filepath);
+		~LTexture();
+
+		LTexture(const LTexture&) = delete;
+		LTexture& operator=(const LTexture&) = delete;
+		LTexture(LTexture&& other) noexcept;
+		LTexture& operator=(LTexture&& other) noexcept;
+
+		//Loads texture using existing file image.
+		bool loadFromFile(std::string path);
+		//Creates texture from already decoded image; the surface stays owned by the caller.
+		bool loadFromSurface(SDL_Surface* surface);
+		//Destroys the texture if it exists.
+		void free();
+		//Sets color modulation of the texture.
+		void setColor(Uint8 red, Uint8 green, Uint8 blue);
+		//renders texture to screen in specified conditions.
+		void render(int x, int y, SDL_Rect* clip = NULL, double angle = 0.0, SDL_Point* center = NULL, SDL_RendererFlip flip = SDL_FLIP_NONE);
+
+		int getWidth();
+		int getHeight();
+
+	private:
+		//The actual hardware texture
+		SDL_Texture* mTexture;
+		//Image dimensions
+		int mWidth;
+		int mHeight;
+		//Path of the image the texture was loaded from
+		std::string filePath;
+	};
+}
@@ -0,0 +1,56 @@
+#include "LevelGenerator.h"
+#include <fstream>
+#include <random>
+using namespace std;
+
+namespace ballgame
+{
+	string generateLevelPattern(const LevelGeneratorSettings& settings)
+	{
+		//Raw engine output is used instead of std distributions, which differ between standard libraries.
+		mt19937 rng(settings.seed);
+		const double range = 4294967296.0;
+		uint32_t threshold = static_cast<uint32_t>(min(settings.density, 1.0) * (range - 1));
+		int totalWeight = 0;
+		for (int weight : settings.resistanceWeights) totalWeight += weight;
+
+		string text;
+		//Every cell takes at most "5_" and every row ends with a line break.
+		text.reserve(static_cast<size_t>(settings.rows) * (settings.columns * 2 + 2));
+		if (settings.chunkRows > 0)
+		{
+			text += "chunks_" + to_string(settings.chunkRows) + "_" + to_string(settings.rows) + "_" + to_string(settings.columns) + "_\r\n";
+		}
+		for (int row = 0; row < settings.rows; row++)
+		{
+			if (row > 0) text += "\r\n";
+			for (int column = 0; column < settings.columns; column++)
+			{
+				int resistance = 0;
+				if (settings.density > 0 && totalWeight > 0 && rng() <= threshold)
+				{
+					int pick = static_cast<int>(rng() % totalWeight);
+					resistance = 1;
+					while (pick >= settings.resistanceWeights[resistance - 1])
+					{
+						pick -= settings.resistanceWeights[resistance - 1];
+						resistance++;
+					}
+				}
+				text += static_cast<char>('0' + resistance);
+				text += '_';
+			}
+		}
+		return text;
+	}
+
+	bool generateLevelFile(const LevelGeneratorSettings& settings, const string& path)
+	{
+		fstream file;
+		file.open(path, ios::out | ios::binary);
+		if (!file.is_open()) return false;
+		string text = generateLevelPattern(settings);
+		file.write(text.data(), text.size());
+		return file.good();
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+
+namespace ballgame
+{
+	//Parameters of a procedurally generated block pattern.
+	struct LevelGeneratorSettings
+	{
+		//Number of block rows.
+		int rows = 5;
+		//Number of block columns.
+		int columns = 10;
+		//Fraction of cells containing a block, from 0 to 1.
+		double density = 0.5;
+		//Relative chance of a block getting resistance 1, 2, 3, 4 and 5.
+		int resistanceWeights[5] = { 5, 4, 3, 2, 1 };
+		//Seed of the generator; the same settings always give the same pattern.
+		unsigned int seed = 1;
+		//Rows per chunk of a streamed level, see LevelStream. 0 generates an ordinary level file.
+		int chunkRows = 0;
+	};
+
+	//Generates block pattern in the '_'-separated format of gamedata/levels files.
+	std::string generateLevelPattern(const LevelGeneratorSettings& settings);
+	//Generates block pattern and writes it to given file.
+	bool generateLevelFile(const LevelGeneratorSettings& settings, const std::string& path);
+}
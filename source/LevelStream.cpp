@@ -0,0 +1,206 @@
+#include "LevelStream.h"
+#include <algorithm>
+#include <cstdlib>
+using namespace std;
+using namespace ballgame;
+
+//Returns whether the line holds no cells; files are read in binary mode, so CRLF lines end with '\r'.
+static bool isBlankLine(const string& line)
+{
+	return line.empty() || line == "\r";
+}
+
+//Parses '_'-separated numbers of a row into values, like splitStringLevels() in the game.
+static void parseRow(const string& line, vector<int>& values)
+{
+	//Start of the number being read
+	size_t start = 0;
+	for (size_t i = 0; i < line.size(); i++)
+	{
+		if (line[i] != '_') continue;
+		values.push_back(atoi(line.c_str() + start));
+		start = i + 1;
+	}
+}
+
+LevelStream::LevelStream()
+{
+}
+
+LevelStream::~LevelStream()
+{
+	close();
+}
+
+int LevelStream::readChunkRows(const string& path)
+{
+	ifstream file(path, ios::in | ios::binary);
+	if (!file.is_open()) return 0;
+	string line;
+	while (getline(file, line) && isBlankLine(line)) {}
+	if (line.compare(0, 7, "chunks_") != 0) return 0;
+	vector<int> values;
+	parseRow(line.substr(7), values);
+	if (values.empty() || values[0] <= 0) return 0;
+	return values[0];
+}
+
+bool LevelStream::open(const string& path)
+{
+	close();
+	ifstream file(path, ios::in | ios::binary);
+	if (!file.is_open()) return false;
+	string line;
+	while (getline(file, line) && isBlankLine(line)) {}
+	if (line.compare(0, 7, "chunks_") != 0) return false;
+	vector<int> values;
+	parseRow(line.substr(7), values);
+	//Sizes in the header let the game lay out the level before any row is read
+	if (values.size() < 3 || values[0] <= 0 || values[1] <= 0 || values[2] <= 0) return false;
+	chunkRows = values[0];
+	rows = values[1];
+	columns = values[2];
+	rowsOffset = file.tellg();
+
+	filePath = path;
+	requested.reserve(16);
+	loaded.reserve(16);
+	inFlight.reserve(16);
+	stopLoader = false;
+	loader = thread(&LevelStream::loaderLoop, this);
+	return true;
+}
+
+void LevelStream::close()
+{
+	if (loader.joinable())
+	{
+		{
+			lock_guard<mutex> lock(queueMutex);
+			stopLoader = true;
+		}
+		queueChanged.notify_all();
+		loader.join();
+	}
+	requested.clear();
+	loaded.clear();
+	inFlight.clear();
+	chunkOffsets.clear();
+	indexedRows = 0;
+	indexOffset = 0;
+	rows = 0;
+	columns = 0;
+	chunkRows = 0;
+}
+
+void LevelStream::request(int chunk)
+{
+	if (chunk < 0 || chunk >= getChunkCount()) return;
+	{
+		lock_guard<mutex> lock(queueMutex);
+		if (find(inFlight.begin(), inFlight.end(), chunk) != inFlight.end()) return;
+		inFlight.push_back(chunk);
+		requested.push_back(chunk);
+	}
+	queueChanged.notify_all();
+}
+
+bool LevelStream::take(LevelChunk& out, bool wait)
+{
+	unique_lock<mutex> lock(queueMutex);
+	if (wait) queueChanged.wait(lock, [this]() { return !loaded.empty() || inFlight.empty() || stopLoader; });
+	if (loaded.empty()) return false;
+	out = move(loaded.front());
+	loaded.erase(loaded.begin());
+	inFlight.erase(find(inFlight.begin(), inFlight.end(), out.index));
+	return true;
+}
+
+int LevelStream::getRows()
+{
+	return rows;
+}
+
+int LevelStream::getColumns()
+{
+	return columns;
+}
+
+int LevelStream::getChunkRows()
+{
+	return chunkRows;
+}
+
+int LevelStream::getChunkCount()
+{
+	return (rows + chunkRows - 1) / max(chunkRows, 1);
+}
+
+void LevelStream::loaderLoop()
+{
+	ifstream file(filePath, ios::in | ios::binary);
+	indexOffset = rowsOffset;
+	while (true)
+	{
+		int chunk;
+		{
+			unique_lock<mutex> lock(queueMutex);
+			queueChanged.wait(lock, [this]() { return !requested.empty() || stopLoader; });
+			if (stopLoader) return;
+			chunk = requested.front();
+			requested.erase(requested.begin());
+		}
+
+		LevelChunk result;
+		result.index = chunk;
+		readChunk(file, chunk, result.resistances);
+		{
+			lock_guard<mutex> lock(queueMutex);
+			loaded.push_back(move(result));
+		}
+		queueChanged.notify_all();
+	}
+}
+
+bool LevelStream::findChunk(ifstream& file, int chunk)
+{
+	if (chunk < static_cast<int>(chunkOffsets.size())) return true;
+	//The offset is unknown once the search reached the end of the file
+	if (indexOffset < 0) return false;
+	//Rows are indexed once, continuing where the previous search stopped
+	file.clear();
+	file.seekg(indexOffset);
+	string line;
+	while (chunk >= static_cast<int>(chunkOffsets.size()))
+	{
+		streamoff offset = file.tellg();
+		if (!getline(file, line)) return false;
+		indexOffset = file.tellg();
+		if (isBlankLine(line)) continue;
+		if (indexedRows % chunkRows == 0) chunkOffsets.push_back(offset);
+		indexedRows++;
+	}
+	return true;
+}
+
+void LevelStream::readChunk(ifstream& file, int chunk, vector<int>& resistances)
+{
+	resistances.assign(static_cast<size_t>(chunkRows) * columns, 0);
+	//Rows missing from the file are left empty
+	if (!findChunk(file, chunk)) return;
+	file.clear();
+	file.seekg(chunkOffsets[chunk]);
+	string line;
+	vector<int> values;
+	int row = 0;
+	while (row < chunkRows && getline(file, line))
+	{
+		if (isBlankLine(line)) continue;
+		values.clear();
+		parseRow(line, values);
+		//Rows are padded or cut to the width of the first row
+		int count = min(static_cast<int>(values.size()), columns);
+		copy(values.begin(), values.begin() + count, resistances.begin() + static_cast<size_t>(row) * columns);
+		row++;
+	}
+}
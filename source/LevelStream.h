@@ -0,0 +1,83 @@
+#pragma once
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ballgame
+{
+	//Rows of a streamed level read by the loader thread.
+	struct LevelChunk
+	{
+		//Index of the chunk, 0 is the top of the level.
+		int index = -1;
+		//Starting resistance of every block of the chunk, row after row. Always rows per chunk * columns values.
+		std::vector<int> resistances;
+	};
+
+	/**
+	Reads chunks of a tall level on a background thread, so only the chunks near the viewport have to be in memory.
+	A chunked level file starts with line "chunks_<rows per chunk>_<rows>_<columns>_" followed by rows in the format of
+	other level files. Of the whole level only the file offset of every chunk is kept; the loader finds them while reading
+	chunks, so opening a level reads only its first line.
+	**/
+	class LevelStream
+	{
+	public:
+		LevelStream();
+		~LevelStream();
+
+		LevelStream(const LevelStream&) = delete;
+		LevelStream& operator=(const LevelStream&) = delete;
+
+		//Returns rows per chunk declared by given level file, or 0 if the file is not a chunked level.
+		static int readChunkRows(const std::string& path);
+
+		//Reads the header of given chunked level file and starts the loader thread. Returns false on failure.
+		bool open(const std::string& path);
+		//Stops the loader thread and forgets the level.
+		void close();
+		//Asks the loader to read the chunk. Chunks already requested and not taken yet are ignored.
+		void request(int chunk);
+		//Moves a chunk read by the loader to out. With wait it blocks until a requested chunk is read. Returns false if there is none.
+		bool take(LevelChunk& out, bool wait);
+
+		int getRows();
+		int getColumns();
+		int getChunkRows();
+		int getChunkCount();
+
+	private:
+		void loaderLoop();
+		//Indexes rows up to the start of given chunk. Returns false if the file ends before it.
+		bool findChunk(std::ifstream& file, int chunk);
+		//Reads rows of given chunk from the file, padding missing rows and cells with 0.
+		void readChunk(std::ifstream& file, int chunk, std::vector<int>& resistances);
+
+		std::string filePath;
+		//File offset of the first row after the header.
+		std::streamoff rowsOffset = 0;
+		//Used only by the loader thread: file offset of the first row of every chunk found so far,
+		//the number of rows indexed and the offset of the row after them.
+		std::vector<std::streamoff> chunkOffsets;
+		int indexedRows = 0;
+		std::streamoff indexOffset = 0;
+		int rows = 0;
+		int columns = 0;
+		int chunkRows = 0;
+
+		std::thread loader;
+		std::mutex queueMutex;
+		//Signals new requests to the loader and read chunks to take().
+		std::condition_variable queueChanged;
+		//Chunks waiting to be read. Queues are vectors with reserved capacity, so requests do not allocate.
+		std::vector<int> requested;
+		//Chunks read and not taken yet.
+		std::vector<LevelChunk> loaded;
+		//Chunks requested and not taken yet, including the one being read.
+		std::vector<int> inFlight;
+		bool stopLoader = false;
+	};
+}
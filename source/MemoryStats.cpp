@@ -0,0 +1,237 @@
+#include "MemoryStats.h"
+#include <SDL.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+using namespace std;
+
+namespace ballgame
+{
+	static atomic<long long> currentBytes[static_cast<int>(MemoryCategory::Count)];
+	static atomic<long long> peakBytes[static_cast<int>(MemoryCategory::Count)];
+	static atomic<unsigned long long> allocationCount{ 0 };
+	//Allocation guard of the calling thread.
+	static thread_local bool guardActive = false;
+	static thread_local unsigned int guardedAllocations = 0;
+	static thread_local size_t firstGuardedSize = 0;
+
+	void trackMemory(MemoryCategory category, long long bytes)
+	{
+		int id = static_cast<int>(category);
+		long long now = currentBytes[id].fetch_add(bytes, memory_order_relaxed) + bytes;
+		long long peak = peakBytes[id].load(memory_order_relaxed);
+		while (now > peak && !peakBytes[id].compare_exchange_weak(peak, now, memory_order_relaxed));
+	}
+
+	long long getMemoryBytes(MemoryCategory category)
+	{
+		return currentBytes[static_cast<int>(category)].load(memory_order_relaxed);
+	}
+
+	long long getMemoryPeak(MemoryCategory category)
+	{
+		return peakBytes[static_cast<int>(category)].load(memory_order_relaxed);
+	}
+
+	const char* getMemoryCategoryName(MemoryCategory category)
+	{
+		switch (category)
+		{
+		case MemoryCategory::CppHeap:
+			return "c++ heap";
+		case MemoryCategory::SdlHeap:
+			return "sdl heap";
+		case MemoryCategory::BlockTextures:
+			return "block textures";
+		case MemoryCategory::TextTextures:
+			return "text textures";
+		case MemoryCategory::SpriteTextures:
+			return "sprite textures";
+		case MemoryCategory::TargetTextures:
+			return "target textures";
+		default:
+			return "unknown";
+		}
+	}
+
+	long long getHeapBytes()
+	{
+		return getMemoryBytes(MemoryCategory::CppHeap) + getMemoryBytes(MemoryCategory::SdlHeap);
+	}
+
+	long long getTextureBytes()
+	{
+		return getMemoryBytes(MemoryCategory::BlockTextures) + getMemoryBytes(MemoryCategory::TextTextures) +
+			getMemoryBytes(MemoryCategory::SpriteTextures) + getMemoryBytes(MemoryCategory::TargetTextures);
+	}
+
+	long long estimateTextureBytes(int width, int height)
+	{
+		return static_cast<long long>(width) * height * 4;
+	}
+
+	unsigned long long getAllocationCount()
+	{
+		return allocationCount.load(memory_order_relaxed);
+	}
+
+	void beginAllocationGuard()
+	{
+		guardActive = true;
+		guardedAllocations = 0;
+		firstGuardedSize = 0;
+	}
+
+	unsigned int endAllocationGuard()
+	{
+		guardActive = false;
+		return guardedAllocations;
+	}
+
+	size_t getFirstGuardedAllocation()
+	{
+		return firstGuardedSize;
+	}
+
+	/**
+	Counts allocation for getAllocationCount() and, if it is made by the game's C++ code, for the guard of the calling thread.
+	SDL grows its render command pool and vertex buffer whenever a frame issues more draw calls than any before,
+	for example when the HUD is first shown, so its allocations would stop debug builds during ordinary play.
+	**/
+	static void countAllocation(size_t size, MemoryCategory category)
+	{
+		allocationCount.fetch_add(1, memory_order_relaxed);
+		if (!guardActive || category != MemoryCategory::CppHeap) return;
+		if (guardedAllocations == 0) firstGuardedSize = size;
+		guardedAllocations++;
+	}
+
+	/**
+	Counted allocations keep their size in a header placed before the returned memory.
+	The header is as big as the strictest fundamental alignment, so the returned memory stays aligned.
+	**/
+	static const size_t headerSize = alignof(max_align_t);
+
+	//Allocates counted block of memory, returns NULL on failure.
+	static void* countedAlloc(size_t size, MemoryCategory category)
+	{
+		char* block = static_cast<char*>(malloc(size + headerSize));
+		if (block == NULL) return NULL;
+		*reinterpret_cast<size_t*>(block) = size;
+		trackMemory(category, static_cast<long long>(size));
+		countAllocation(size, category);
+		return block + headerSize;
+	}
+
+	//Frees block allocated by countedAlloc.
+	static void countedFree(void* memory, MemoryCategory category)
+	{
+		if (memory == NULL) return;
+		char* block = static_cast<char*>(memory) - headerSize;
+		trackMemory(category, -static_cast<long long>(*reinterpret_cast<size_t*>(block)));
+		free(block);
+	}
+
+	static void* sdlMalloc(size_t size)
+	{
+		return countedAlloc(size, MemoryCategory::SdlHeap);
+	}
+
+	static void* sdlCalloc(size_t count, size_t size)
+	{
+		void* memory = countedAlloc(count * size, MemoryCategory::SdlHeap);
+		if (memory != NULL) memset(memory, 0, count * size);
+		return memory;
+	}
+
+	static void* sdlRealloc(void* memory, size_t size)
+	{
+		if (memory == NULL) return sdlMalloc(size);
+		char* block = static_cast<char*>(memory) - headerSize;
+		size_t oldSize = *reinterpret_cast<size_t*>(block);
+		char* newBlock = static_cast<char*>(realloc(block, size + headerSize));
+		if (newBlock == NULL) return NULL;
+		*reinterpret_cast<size_t*>(newBlock) = size;
+		countAllocation(size, MemoryCategory::SdlHeap);
+		trackMemory(MemoryCategory::SdlHeap, static_cast<long long>(size) - static_cast<long long>(oldSize));
+		return newBlock + headerSize;
+	}
+
+	static void sdlFree(void* memory)
+	{
+		countedFree(memory, MemoryCategory::SdlHeap);
+	}
+
+	void trackSdlAllocations()
+	{
+		if (SDL_SetMemoryFunctions(sdlMalloc, sdlCalloc, sdlRealloc, sdlFree) != 0)
+		{
+			printf("Unable to track SDL allocations! SDL Error: %s\n", SDL_GetError());
+		}
+	}
+
+	void printMemoryStats()
+	{
+		printf("Memory usage:\n");
+		for (int i = 0; i < static_cast<int>(MemoryCategory::Count); i++)
+		{
+			MemoryCategory category = static_cast<MemoryCategory>(i);
+			printf("  %-16s %10lld KB now %10lld KB peak\n", getMemoryCategoryName(category), getMemoryBytes(category) / 1024, getMemoryPeak(category) / 1024);
+		}
+	}
+}
+
+//Replacements of the global allocation functions, counting all C++ heap allocations of the game.
+void* operator new(size_t size)
+{
+	void* memory = ballgame::countedAlloc(size, ballgame::MemoryCategory::CppHeap);
+	if (memory == NULL) throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return ballgame::countedAlloc(size, ballgame::MemoryCategory::CppHeap);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return ballgame::countedAlloc(size, ballgame::MemoryCategory::CppHeap);
+}
+
+void operator delete(void* memory) noexcept
+{
+	ballgame::countedFree(memory, ballgame::MemoryCategory::CppHeap);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	ballgame::countedFree(memory, ballgame::MemoryCategory::CppHeap);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	ballgame::countedFree(memory, ballgame::MemoryCategory::CppHeap);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	ballgame::countedFree(memory, ballgame::MemoryCategory::CppHeap);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	ballgame::countedFree(memory, ballgame::MemoryCategory::CppHeap);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	ballgame::countedFree(memory, ballgame::MemoryCategory::CppHeap);
+}
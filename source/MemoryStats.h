@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+
+namespace ballgame
+{
+	//Kinds of memory accounted by the game.
+	enum class MemoryCategory
+	{
+		//Heap allocated through operator new.
+		CppHeap,
+		//Heap allocated by SDL and its libraries through SDL_malloc.
+		SdlHeap,
+		//Estimated size of textures of blocks.
+		BlockTextures,
+		//Estimated size of textures of rendered text.
+		TextTextures,
+		//Estimated size of textures of images, like the ball.
+		SpriteTextures,
+		//Estimated size of render target textures.
+		TargetTextures,
+		Count
+	};
+
+	//Adds (or with negative value removes) bytes of given category.
+	void trackMemory(MemoryCategory category, long long bytes);
+	//Returns bytes of given category in use now.
+	long long getMemoryBytes(MemoryCategory category);
+	//Returns the highest number of bytes of given category in use so far.
+	long long getMemoryPeak(MemoryCategory category);
+	//Returns readable name of the category.
+	const char* getMemoryCategoryName(MemoryCategory category);
+
+	//Returns bytes of CPU heap in use now.
+	long long getHeapBytes();
+	//Returns estimated bytes of all textures in use now.
+	long long getTextureBytes();
+	//Estimated size of a texture of given dimensions, assuming 4 bytes per pixel.
+	long long estimateTextureBytes(int width, int height);
+
+	//Returns number of heap allocations (C++ and SDL) made so far.
+	unsigned long long getAllocationCount();
+	//Starts counting C++ heap allocations made by the calling thread, used to check code that must not allocate. SDL allocations are not counted.
+	void beginAllocationGuard();
+	//Stops counting and returns number of allocations the calling thread made since beginAllocationGuard().
+	unsigned int endAllocationGuard();
+	//Returns size of the first allocation counted by the last guard of the calling thread.
+	size_t getFirstGuardedAllocation();
+
+	//Routes SDL allocations through counting functions. Must be called before any other SDL function.
+	void trackSdlAllocations();
+	//Prints current and peak bytes of every category.
+	void printMemoryStats();
+}
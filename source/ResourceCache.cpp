@@ -0,0 +1,105 @@
+#include "ResourceCache.h"
+#include "MemoryStats.h"
+using namespace std;
+using namespace ballgame;
+
+ResourceCache::ResourceCache(size_t budgetBytes)
+{
+	budget = budgetBytes;
+}
+
+ResourceCache::~ResourceCache()
+{
+	clear();
+}
+
+shared_ptr<LTexture> ResourceCache::getTexture(const string& path)
+{
+	return getTexture(path, NULL);
+}
+
+shared_ptr<LTexture> ResourceCache::getTexture(const string& path, SDL_Surface* decoded)
+{
+	auto found = entries.find(path);
+	if (found != entries.end())
+	{
+		//Move entry to the front of the lru list
+		lru.splice(lru.begin(), lru, found->second.lruPos);
+		hits++;
+		if (decoded != NULL) SDL_FreeSurface(decoded);
+		return found->second.texture;
+	}
+
+	misses++;
+	shared_ptr<LTexture> texture = make_shared<LTexture>(path);
+	bool loaded;
+	if (decoded != NULL)
+	{
+		loaded = texture->loadFromSurface(decoded);
+		SDL_FreeSurface(decoded);
+	}
+	else loaded = texture->loadFromFile(path);
+	if (!loaded) return nullptr;
+
+	Entry entry;
+	entry.texture = texture;
+	//RGBA8888 estimate of the uploaded texture
+	entry.bytes = static_cast<size_t>(estimateTextureBytes(texture->getWidth(), texture->getHeight()));
+	lru.push_front(path);
+	entry.lruPos = lru.begin();
+	usedBytes += entry.bytes;
+	trackMemory(MemoryCategory::SpriteTextures, entry.bytes);
+	entries.emplace(path, entry);
+
+	trim();
+	return texture;
+}
+
+void ResourceCache::setBudget(size_t budgetBytes)
+{
+	budget = budgetBytes;
+	trim();
+}
+
+void ResourceCache::trim()
+{
+	auto it = lru.end();
+	while (usedBytes > budget && it != lru.begin())
+	{
+		--it;
+		Entry& entry = entries[*it];
+		//Texture still used somewhere, it cannot be dropped
+		if (entry.texture.use_count() > 1) continue;
+		usedBytes -= entry.bytes;
+		trackMemory(MemoryCategory::SpriteTextures, -static_cast<long long>(entry.bytes));
+		entries.erase(*it);
+		it = lru.erase(it);
+	}
+}
+
+void ResourceCache::clear()
+{
+	for (auto& entry : entries)
+	{
+		entry.second.texture->free();
+	}
+	entries.clear();
+	lru.clear();
+	trackMemory(MemoryCategory::SpriteTextures, -static_cast<long long>(usedBytes));
+	usedBytes = 0;
+}
+
+size_t ResourceCache::getUsedBytes()
+{
+	return usedBytes;
+}
+
+int ResourceCache::getHits()
+{
+	return hits;
+}
+
+int ResourceCache::getMisses()
+{
+	return misses;
+}
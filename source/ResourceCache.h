@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "LTexture.h"
+
+namespace ballgame
+{
+	/**
+	Cache of textures loaded from disk, keyed by file path.
+	Repeated requests for the same path share one texture instead of decoding and uploading it again.
+	Entries not used anywhere else are evicted in least-recently-used order when the cache exceeds its byte budget.
+	**/
+	class ResourceCache
+	{
+	public:
+		ResourceCache(size_t budgetBytes);
+		~ResourceCache();
+
+		ResourceCache(const ResourceCache&) = delete;
+		ResourceCache& operator=(const ResourceCache&) = delete;
+
+		//Returns shared handle to the texture of given path, loading it if it is not cached. Returns empty handle on failure.
+		std::shared_ptr<LTexture> getTexture(const std::string& path);
+		//Same as getTexture(path), but on a miss uploads the given already decoded image instead of reading the file. Frees the surface.
+		std::shared_ptr<LTexture> getTexture(const std::string& path, SDL_Surface* decoded);
+		//Changes the byte budget and evicts entries over it.
+		void setBudget(size_t budgetBytes);
+		//Evicts least recently used unreferenced entries until the cache fits in its budget.
+		void trim();
+		//Frees all textures, including the ones still held by handles. Must be called before the renderer is destroyed.
+		void clear();
+
+		//Estimated bytes of all cached textures.
+		size_t getUsedBytes();
+		//Number of requests served from the cache.
+		int getHits();
+		//Number of requests that had to load the file.
+		int getMisses();
+
+	private:
+		struct Entry
+		{
+			std::shared_ptr<LTexture> texture;
+			size_t bytes;
+			std::list<std::string>::iterator lruPos;
+		};
+
+		std::unordered_map<std::string, Entry> entries;
+		//Paths ordered from most (front) to least (back) recently used.
+		std::list<std::string> lru;
+		size_t budget;
+		size_t usedBytes = 0;
+		int hits = 0;
+		int misses = 0;
+	};
+}
@@ -0,0 +1,88 @@
+#include "SceneTarget.h"
+#include "MemoryStats.h"
+#include <stdio.h>
+#include <string>
+using namespace std;
+using namespace ballgame;
+
+SceneTarget::SceneTarget()
+{
+}
+
+SceneTarget::~SceneTarget()
+{
+	free();
+}
+
+bool SceneTarget::create(SDL_Renderer* renderer, int width, int height, float scale, bool linear)
+{
+	if (!SDL_RenderTargetSupported(renderer))
+	{
+		printf("Renderer does not support render targets, the scene is drawn at window resolution.\n");
+		return false;
+	}
+	int newWidth = static_cast<int>(width * scale + 0.5f);
+	int newHeight = static_cast<int>(height * scale + 0.5f);
+	if (newWidth < 1 || newHeight < 1) return false;
+
+	//SDL 2.0.10 takes filtering of a texture from the hint at its creation, so the hint is set only around it
+	const char* hint = SDL_GetHint(SDL_HINT_RENDER_SCALE_QUALITY);
+	string previous = (hint != NULL) ? hint : "";
+	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, linear ? "1" : "0");
+	SDL_Texture* newTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, newWidth, newHeight);
+	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, previous.c_str());
+	//An existing texture is kept on failure, so the scene stays at its current scale
+	if (newTexture == NULL)
+	{
+		printf("Unable to create scene target! SDL Error: %s\n", SDL_GetError());
+		return false;
+	}
+	free();
+	texture = newTexture;
+	windowWidth = width;
+	windowHeight = height;
+	this->width = newWidth;
+	this->height = newHeight;
+	this->scale = scale;
+	textureBytes = estimateTextureBytes(this->width, this->height);
+	trackMemory(MemoryCategory::TargetTextures, textureBytes);
+	return true;
+}
+
+void SceneTarget::free()
+{
+	if (texture == NULL) return;
+	SDL_DestroyTexture(texture);
+	texture = NULL;
+	active = false;
+	scale = 1.0f;
+	trackMemory(MemoryCategory::TargetTextures, -textureBytes);
+	textureBytes = 0;
+}
+
+bool SceneTarget::isCreated()
+{
+	return texture != NULL;
+}
+
+void SceneTarget::begin(SDL_Renderer* renderer)
+{
+	if (texture == NULL || active) return;
+	SDL_SetRenderTarget(renderer, texture);
+	//Scale is reset by every change of the target, and restored with the window
+	SDL_RenderSetScale(renderer, static_cast<float>(width) / windowWidth, static_cast<float>(height) / windowHeight);
+	active = true;
+}
+
+void SceneTarget::end(SDL_Renderer* renderer)
+{
+	if (!active) return;
+	SDL_SetRenderTarget(renderer, NULL);
+	SDL_RenderCopy(renderer, texture, NULL, NULL);
+	active = false;
+}
+
+float SceneTarget::getScale()
+{
+	return scale;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <SDL.h>
+
+namespace ballgame
+{
+	/**
+	Offscreen texture the scene is drawn into at an internal resolution, then stretched over the window.
+	While drawing into it the renderer scale maps window coordinates onto the texture, so drawing code and game logic
+	keep using window coordinates at any resolution.
+	**/
+	class SceneTarget
+	{
+	public:
+		SceneTarget();
+		~SceneTarget();
+
+		SceneTarget(const SceneTarget&) = delete;
+		SceneTarget& operator=(const SceneTarget&) = delete;
+
+		/**
+		Creates the texture for a window of given size drawn at given scale, replacing an existing one.
+		Linear filtering blends neighbouring pixels when stretching, otherwise the nearest pixel is repeated.
+		Returns false on failure, keeping the existing texture.
+		**/
+		bool create(SDL_Renderer* renderer, int width, int height, float scale, bool linear);
+		//Destroys the texture if it exists.
+		void free();
+		//Returns whether the scene can be drawn into the texture.
+		bool isCreated();
+
+		//Directs drawing into the texture. Does nothing without one.
+		void begin(SDL_Renderer* renderer);
+		//Directs drawing back to the window and stretches the texture over it. Does nothing unless begin() was called.
+		void end(SDL_Renderer* renderer);
+
+		//Returns scale of the texture to the window, 1 without a texture.
+		float getScale();
+
+	private:
+		SDL_Texture* texture = NULL;
+		//Size of the window in pixels, the coordinates drawing code uses.
+		int windowWidth = 0;
+		int windowHeight = 0;
+		//Size of the texture in pixels.
+		int width = 0;
+		int height = 0;
+		float scale = 1.0f;
+		//Defines whether drawing goes into the texture.
+		bool active = false;
+		//Estimated bytes of the texture.
+		long long textureBytes = 0;
+	};
+}
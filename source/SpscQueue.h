@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+namespace ballgame
+{
+	/**
+	Wait-free bounded queue for one producer and one consumer thread.
+	Capacity must be a power of two. Pushing to a full queue fails instead of waiting.
+	**/
+	template <typename T, size_t Capacity>
+	class SpscQueue
+	{
+		static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+	public:
+		//Adds value at the end. Returns false if the queue is full. Producer only.
+		bool push(const T& value)
+		{
+			size_t head = headIndex.load(std::memory_order_relaxed);
+			if (head - tailIndex.load(std::memory_order_acquire) >= Capacity) return false;
+			items[head & (Capacity - 1)] = value;
+			headIndex.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		//Takes value from the front. Returns false if the queue is empty. Consumer only.
+		bool pop(T& value)
+		{
+			size_t tail = tailIndex.load(std::memory_order_relaxed);
+			if (tail == headIndex.load(std::memory_order_acquire)) return false;
+			value = items[tail & (Capacity - 1)];
+			tailIndex.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		T items[Capacity];
+		std::atomic<size_t> headIndex{ 0 };
+		std::atomic<size_t> tailIndex{ 0 };
+	};
+}
@@ -0,0 +1,105 @@
+#include "Telemetry.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+namespace ballgame
+{
+	atomic<bool> telemetryEnabled{ false };
+	thread_local uint32_t telemetryTick = 0;
+	thread_local TelemetryRing* telemetryRing = NULL;
+
+	//Rings of all threads that ever emitted. They are kept until the sink stops, so records of finished threads are not lost.
+	static vector<unique_ptr<TelemetryRing>> rings;
+	//Guards the list of rings, taken only when a thread registers and while the flusher copies the list.
+	static mutex ringsMutex;
+	//Copy of the list the flusher writes from, so registering threads never wait for the file.
+	static vector<TelemetryRing*> drainedRings;
+	//Thread writing records to the file.
+	static thread flusher;
+	//Set to ask the flusher to finish.
+	static atomic<bool> flusherStop{ false };
+	//Output file.
+	static FILE* telemetryFile = NULL;
+
+	TelemetryRing* registerTelemetryThread()
+	{
+		lock_guard<mutex> lock(ringsMutex);
+		rings.push_back(unique_ptr<TelemetryRing>(new TelemetryRing()));
+		telemetryRing = rings.back().get();
+		return telemetryRing;
+	}
+
+	//Writes all records waiting in the rings to the file.
+	static void drainRings()
+	{
+		//Rings are never freed while the sink runs, so they stay valid after the lock is released
+		{
+			lock_guard<mutex> lock(ringsMutex);
+			drainedRings.clear();
+			for (auto& ring : rings) drainedRings.push_back(ring.get());
+		}
+		for (TelemetryRing* ring : drainedRings)
+		{
+			uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+			uint32_t head = ring->head.load(std::memory_order_acquire);
+			while (tail != head)
+			{
+				//Write the contiguous part up to the end of the buffer at once
+				uint32_t first = tail & (TelemetryRing::capacity - 1);
+				uint32_t count = head - tail;
+				if (first + count > TelemetryRing::capacity) count = TelemetryRing::capacity - first;
+				fwrite(&ring->records[first], sizeof(TelemetryRecord), count, telemetryFile);
+				tail += count;
+			}
+			ring->tail.store(tail, std::memory_order_release);
+		}
+	}
+
+	static void flushLoop()
+	{
+		while (!flusherStop.load())
+		{
+			drainRings();
+			this_thread::sleep_for(chrono::milliseconds(100));
+		}
+		drainRings();
+	}
+
+	bool startTelemetry(const string& path)
+	{
+		if (telemetryEnabled) return true;
+		telemetryFile = fopen(path.c_str(), "wb");
+		if (telemetryFile == NULL)
+		{
+			printf("Unable to open telemetry file %s!\n", path.c_str());
+			return false;
+		}
+		uint32_t header[3] = { telemetryMagic, telemetryVersion, sizeof(TelemetryRecord) };
+		fwrite(header, sizeof(header), 1, telemetryFile);
+
+		flusherStop = false;
+		flusher = thread(flushLoop);
+		telemetryEnabled = true;
+		return true;
+	}
+
+	void stopTelemetry()
+	{
+		if (!telemetryEnabled) return;
+		telemetryEnabled = false;
+		flusherStop = true;
+		flusher.join();
+
+		uint32_t dropped = 0;
+		for (auto& ring : rings) dropped += ring->dropped.load();
+		if (dropped > 0) printf("Telemetry dropped %u records.\n", dropped);
+
+		fclose(telemetryFile);
+		telemetryFile = NULL;
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace ballgame
+{
+	//Kinds of recorded gameplay events. Meaning of a, b, c fields is given for each one.
+	enum class TelemetryEvent : uint8_t
+	{
+		//Ball speed after a tick. a = vx, b = vy, c = ticks the record stands for: 1, or a span skipped by fast-forward (0 in old files means 1).
+		BallMove = 1,
+		//Ball velocity reduced after reaching vMax. a = vx, b = vy, c = 0 for y-focus, 1 for x-focus.
+		VMaxClamp = 2,
+		//Block destroyed or weakened. a = block id, b = resistance left, c = unused.
+		BlockHit = 3,
+		//Ball fell below the racket. a = health left, b = unused, c = unused.
+		LifeLost = 4,
+		//Game ended after losing all lives. a = level reached, b = unused, c = unused.
+		GameOver = 5
+	};
+
+	//Single record as written to the telemetry file. 16 bytes, little-endian.
+	struct TelemetryRecord
+	{
+		//Game tick the event happened on.
+		uint32_t tick;
+		//TelemetryEvent value.
+		uint8_t type;
+		//Level the event happened on.
+		uint8_t level;
+		int16_t a;
+		int16_t b;
+		int16_t c;
+		//Points of the player at the moment of the event.
+		int32_t points;
+	};
+	static_assert(sizeof(TelemetryRecord) == 16, "telemetry record layout changed");
+
+	//Magic number opening the telemetry file ("BGTL"), followed by uint32 version and uint32 record size.
+	const uint32_t telemetryMagic = 0x4c544742;
+	const uint32_t telemetryVersion = 1;
+
+	/**
+	Single producer / single consumer ring of records.
+	Each thread emitting events owns one, the flushing thread is the only consumer.
+	**/
+	struct TelemetryRing
+	{
+		static const uint32_t capacity = 4096;
+		TelemetryRecord records[capacity];
+		//Next slot written by the producer.
+		std::atomic<uint32_t> head{ 0 };
+		//Next slot read by the consumer.
+		std::atomic<uint32_t> tail{ 0 };
+		//Records lost because the ring was full.
+		std::atomic<uint32_t> dropped{ 0 };
+	};
+
+	//Set while the telemetry sink is running.
+	extern std::atomic<bool> telemetryEnabled;
+	//Tick of the game played by the calling thread, stamped on its records. Every thread steps its own worlds, like gamestate.
+	extern thread_local uint32_t telemetryTick;
+	//Ring of the calling thread, NULL until it emits the first event.
+	extern thread_local TelemetryRing* telemetryRing;
+
+	//Opens the output file and starts the flushing thread.
+	bool startTelemetry(const std::string& path);
+	//Flushes remaining records, stops the flushing thread and closes the file.
+	void stopTelemetry();
+	//Creates and registers ring of the calling thread.
+	TelemetryRing* registerTelemetryThread();
+
+	//Advances the tick stamped on subsequent records of the calling thread.
+	inline void setTelemetryTick(uint32_t tick)
+	{
+		telemetryTick = tick;
+	}
+
+	/**
+	Records an event, dropping it if the ring is full. Never waits for the file; only the first event of a thread
+	allocates its ring and briefly takes the lock of the ring list.
+	**/
+	inline void emitTelemetry(TelemetryEvent type, int level, int a, int b, int c, int points)
+	{
+		if (!telemetryEnabled.load(std::memory_order_relaxed)) return;
+		TelemetryRing* ring = telemetryRing;
+		if (ring == NULL) ring = registerTelemetryThread();
+
+		uint32_t head = ring->head.load(std::memory_order_relaxed);
+		if (head - ring->tail.load(std::memory_order_acquire) >= TelemetryRing::capacity)
+		{
+			ring->dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		TelemetryRecord& record = ring->records[head & (TelemetryRing::capacity - 1)];
+		record.tick = telemetryTick;
+		record.type = static_cast<uint8_t>(type);
+		record.level = static_cast<uint8_t>(level);
+		record.a = static_cast<int16_t>(a);
+		record.b = static_cast<int16_t>(b);
+		record.c = static_cast<int16_t>(c);
+		record.points = points;
+		ring->head.store(head + 1, std::memory_order_release);
+	}
+}
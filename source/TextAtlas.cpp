@@ -0,0 +1,110 @@
+#include "TextAtlas.h"
+#include "MemoryStats.h"
+#include <stdio.h>
+using namespace ballgame;
+
+//Widest row of glyphs in the atlas, small enough for the texture size limit of any renderer.
+static const int atlasRowWidth = 1024;
+
+TextAtlas::TextAtlas()
+{
+}
+
+TextAtlas::~TextAtlas()
+{
+	free();
+}
+
+bool TextAtlas::create(SDL_Renderer* renderer, TTF_Font* font)
+{
+	free();
+	const int count = lastGlyph - firstGlyph + 1;
+	const SDL_Color white = { 255, 255, 255, 255 };
+	SDL_Surface* rendered[count] = {};
+
+	//Glyphs are packed in rows, wrapping before atlasRowWidth
+	height = TTF_FontHeight(font);
+	int x = 0;
+	int y = 0;
+	for (int i = 0; i < count; i++)
+	{
+		rendered[i] = TTF_RenderGlyph_Solid(font, static_cast<Uint16>(firstGlyph + i), white);
+		int w = (rendered[i] != NULL) ? rendered[i]->w : 0;
+		if (x + w > atlasRowWidth)
+		{
+			x = 0;
+			y += height;
+		}
+		glyphs[i] = { x, y, w, height };
+		x += w;
+	}
+
+	SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, atlasRowWidth, y + height, 32, SDL_PIXELFORMAT_RGBA8888);
+	if (atlas != NULL)
+	{
+		SDL_FillRect(atlas, NULL, SDL_MapRGBA(atlas->format, 0, 0, 0, 0));
+		for (int i = 0; i < count; i++)
+		{
+			if (rendered[i] != NULL) SDL_BlitSurface(rendered[i], NULL, atlas, &glyphs[i]);
+		}
+		texture = SDL_CreateTextureFromSurface(renderer, atlas);
+		if (texture == NULL) printf("Unable to create text atlas! SDL Error: %s\n", SDL_GetError());
+		else
+		{
+			SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+			textureBytes = estimateTextureBytes(atlas->w, atlas->h);
+			trackMemory(MemoryCategory::TextTextures, textureBytes);
+		}
+		SDL_FreeSurface(atlas);
+	}
+	else printf("Unable to create text atlas surface! SDL Error: %s\n", SDL_GetError());
+
+	for (int i = 0; i < count; i++)
+	{
+		SDL_FreeSurface(rendered[i]);
+	}
+	return texture != NULL;
+}
+
+void TextAtlas::free()
+{
+	if (texture == NULL) return;
+	SDL_DestroyTexture(texture);
+	texture = NULL;
+	trackMemory(MemoryCategory::TextTextures, -textureBytes);
+	textureBytes = 0;
+}
+
+bool TextAtlas::isCreated()
+{
+	return texture != NULL;
+}
+
+int TextAtlas::measure(const char* text)
+{
+	int width = 0;
+	for (const char* c = text; *c != '\0'; c++)
+	{
+		if (*c < firstGlyph || *c > lastGlyph) continue;
+		width += glyphs[*c - firstGlyph].w;
+	}
+	return width;
+}
+
+void TextAtlas::render(SDL_Renderer* renderer, const char* text, SDL_Color color, const SDL_Rect& box)
+{
+	int width = measure(text);
+	if (texture == NULL || width == 0) return;
+	SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
+	//Every glyph is scaled by the same factor as the whole text
+	int advance = 0;
+	for (const char* c = text; *c != '\0'; c++)
+	{
+		if (*c < firstGlyph || *c > lastGlyph) continue;
+		const SDL_Rect& glyph = glyphs[*c - firstGlyph];
+		int left = box.x + advance * box.w / width;
+		advance += glyph.w;
+		SDL_Rect target = { left, box.y, box.x + advance * box.w / width - left, box.h };
+		SDL_RenderCopy(renderer, texture, &glyph, &target);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <SDL.h>
+#include <SDL_ttf.h>
+
+namespace ballgame
+{
+	/**
+	Printable ASCII glyphs of a font rendered once into a single white texture.
+	Text is drawn by copying glyphs from it, so drawing it every frame needs no surface, texture or heap allocation.
+	**/
+	class TextAtlas
+	{
+	public:
+		TextAtlas();
+		~TextAtlas();
+
+		TextAtlas(const TextAtlas&) = delete;
+		TextAtlas& operator=(const TextAtlas&) = delete;
+
+		//Renders glyphs of the font into the atlas texture. Returns false on failure.
+		bool create(SDL_Renderer* renderer, TTF_Font* font);
+		//Destroys the atlas texture if it exists.
+		void free();
+		//Returns whether the atlas can draw text.
+		bool isCreated();
+
+		//Returns width of the text in pixels of the font. Characters without a glyph are skipped.
+		int measure(const char* text);
+		//Draws the text in given color stretched to the box, like a texture of the whole rendered text would be.
+		void render(SDL_Renderer* renderer, const char* text, SDL_Color color, const SDL_Rect& box);
+
+	private:
+		static const char firstGlyph = ' ';
+		static const char lastGlyph = '~';
+
+		SDL_Texture* texture = NULL;
+		//Position of every glyph in the texture; its width is the advance of the glyph.
+		SDL_Rect glyphs[lastGlyph - firstGlyph + 1];
+		//Height of every glyph, the height of the font.
+		int height = 0;
+		//Estimated bytes of the texture.
+		long long textureBytes = 0;
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+
+namespace ballgame
+{
+	/**
+	Lock-free triple buffer passing the newest value from one writer thread to one reader thread.
+	The writer fills writeBuffer() and publishes it; the reader takes the newest published value with update().
+	Neither side ever waits and intermediate values the reader did not take are skipped.
+	**/
+	template <typename T>
+	class TripleBuffer
+	{
+	public:
+		//Buffer owned by the writer, filled before publish().
+		T& writeBuffer()
+		{
+			return buffers[back];
+		}
+
+		//Makes the write buffer the newest value and takes a free buffer for the next write.
+		void publish()
+		{
+			back = middle.exchange(back | freshBit, std::memory_order_acq_rel) & indexMask;
+		}
+
+		//Takes the newest published value if there is one not read yet. Returns whether readBuffer() changed.
+		bool update()
+		{
+			if ((middle.load(std::memory_order_relaxed) & freshBit) == 0) return false;
+			front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+			return true;
+		}
+
+		//Buffer owned by the reader, holding the value taken by the last update().
+		const T& readBuffer()
+		{
+			return buffers[front];
+		}
+
+	private:
+		//Marks the middle buffer as published and not read yet.
+		static const int freshBit = 4;
+		static const int indexMask = 3;
+
+		T buffers[3];
+		//Index of the buffer exchanged between the threads, with freshBit.
+		std::atomic<int> middle{ 1 };
+		//Index of the buffer owned by the writer.
+		int back = 0;
+		//Index of the buffer owned by the reader.
+		int front = 2;
+	};
+}
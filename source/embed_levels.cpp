@@ -0,0 +1,149 @@
+/**
+Writes source/EmbeddedLevelData.h, the level texts compiled into builds with BALLGAME_EMBEDDED_LEVELS, from the level files.
+Usage: embed_levels [--check] [gamedata directory] [output header]
+Defaults are gamedata and source/EmbeddedLevelData.h, so it is run from the directory containing both.
+With --check nothing is written; it fails if the header differs from the level files, for use as a build or commit check.
+**/
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//Reads lines of a text file without line breaks, skipping empty ones. Returns false if it cannot be read.
+bool readLines(const string& filename, vector<string>& lines)
+{
+	ifstream file(filename);
+	if (!file.is_open()) return false;
+	string line;
+	while (getline(file, line))
+	{
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (!line.empty()) lines.push_back(line);
+	}
+	return !file.bad();
+}
+
+//Appends lines as a raw string literal, opened on its own line like the files start. Returns false if a line would end it.
+bool appendRawString(string& out, const vector<string>& lines)
+{
+	out += "R\"(";
+	for (const string& line : lines)
+	{
+		if (line.find(")\"") != string::npos) return false;
+		out += "\n" + line;
+	}
+	out += ")\"";
+	return true;
+}
+
+//Drops carriage returns, so a header checked out with other line endings still matches.
+string withoutCarriageReturns(const string& text)
+{
+	string result;
+	for (char c : text)
+	{
+		if (c != '\r') result += c;
+	}
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	bool check = false;
+	vector<string> paths;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "--check") check = true;
+		else paths.push_back(arg);
+	}
+	if (paths.size() > 2)
+	{
+		printf("Usage: %s [--check] [gamedata directory] [output header]\n", argv[0]);
+		return 1;
+	}
+	string gamedata = paths.size() > 0 ? paths[0] : "gamedata";
+	string output = paths.size() > 1 ? paths[1] : "source/EmbeddedLevelData.h";
+
+	vector<string> levelData;
+	if (!readLines(gamedata + "/levels.txt", levelData))
+	{
+		printf("Unable to read %s/levels.txt!\n", gamedata.c_str());
+		return 1;
+	}
+
+	string header;
+	header += "#pragma once\n";
+	header += "//Generated by embed_levels from gamedata/levels.txt and gamedata/levels/levelN.txt, do not edit. See EmbeddedLevels.h.\n";
+	header += "\n";
+	header += "namespace ballgame\n";
+	header += "{\n";
+	header += "\tnamespace embedded\n";
+	header += "\t{\n";
+	header += "\t\t//Copy of gamedata/levels.txt\n";
+	header += "\t\tconstexpr const char levelData[] = ";
+	if (!appendRawString(header, levelData))
+	{
+		printf("%s/levels.txt cannot be embedded!\n", gamedata.c_str());
+		return 1;
+	}
+	header += ";\n";
+	header += "\n";
+	header += "\t\t//Copies of gamedata/levels/levelN.txt\n";
+	header += "\t\tconstexpr const char* levelPatterns[] = {\n";
+	//Every line of the level data describes one level
+	for (size_t level = 1; level <= levelData.size(); level++)
+	{
+		string filename = gamedata + "/levels/level" + to_string(level) + ".txt";
+		vector<string> pattern;
+		if (!readLines(filename, pattern))
+		{
+			printf("Unable to read %s!\n", filename.c_str());
+			return 1;
+		}
+		header += "\t\t\t";
+		if (!appendRawString(header, pattern))
+		{
+			printf("%s cannot be embedded!\n", filename.c_str());
+			return 1;
+		}
+		header += level < levelData.size() ? ",\n" : "\n";
+	}
+	header += "\t\t};\n";
+	header += "\t}\n";
+	header += "}\n";
+
+	if (check)
+	{
+		ifstream file(output, ios::binary);
+		stringstream current;
+		current << file.rdbuf();
+		if (!file.is_open() || withoutCarriageReturns(current.str()) != header)
+		{
+			printf("%s does not match the level files, run embed_levels to update it.\n", output.c_str());
+			return 1;
+		}
+		printf("%s is up to date.\n", output.c_str());
+		return 0;
+	}
+
+	//Sources of the game use CRLF line endings
+	string text;
+	for (char c : header)
+	{
+		if (c == '\n') text += '\r';
+		text += c;
+	}
+	ofstream file(output, ios::binary);
+	file << text;
+	if (!file.good())
+	{
+		printf("Unable to write %s!\n", output.c_str());
+		return 1;
+	}
+	printf("Wrote %s.\n", output.c_str());
+	return 0;
+}
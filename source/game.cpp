@@ -7,41 +7,77 @@
 #include <cmath>
 #include <iostream>
 #include "LTexture.h"
+#include "ResourceCache.h"
+#include "Telemetry.h"
+#include "LevelGenerator.h"
+#include "LevelStream.h"
+#include "MemoryStats.h"
+#include "TextAtlas.h"
+#include "SceneTarget.h"
+#include "EventWaiter.h"
+#include "TripleBuffer.h"
+#include "SpscQueue.h"
+#include "BatchLayout.h"
+#ifdef BALLGAME_EMBEDDED_LEVELS
+#include "EmbeddedLevels.h"
+#endif
 #include <fstream>
+#include <memory>
+#include <vector>
+#include <type_traits>
+#include <future>
+#include <mutex>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
 
 using namespace std;
 
 
 namespace ballgame
 {
-	void splitStringLevels(string text, char ch, int row, int id);
-	void splitStringData(string text, char ch, int id);
+	void splitStringLevels(const string& text, char ch, int row, int id);
+	void splitStringData(const string& text, char ch, int id);
 	bool loadLevelInfo(int levelnumber);
 	bool loadLevelPattern(int levelnumber);
 	bool loadLevel(int levelid);
 	void defineBlocks(int levelid);
 	bool renderBlocks();
+	void updateVisibleBlocks();
+	void scrollLevel();
+	bool levelCleared();
 
 
 	void levelEndText(bool isWin);
 	void levelBeginText(int levelid);
+	void drawLevelEndText(bool isWin, int points);
+	void drawLevelBeginText(int levelid);
 	void renderHud();
+	bool canRender();
 
 	void checkBlocksHit();
 	void handleEndLevel();
 
 	void drawFrame();
+	bool advanceLevel();
 
 	//Run the game
 	bool run();
 	//Initialize all sdl components
 	bool init();
-	//Loads media files needed
-	bool loadMedia();
+	//Uploads decoded media files to the renderer
+	bool loadMedia(SDL_Surface* ballSurface, TTF_Font* font);
 	//Closes all sdl components
 	void close();
 	//Sets drawing color
 	void setDrawColor(int r, int g, int b);
+	//Starts drawing the scene
+	void beginScene();
+	//Ends drawing the scene, text is drawn afterwards
+	void endScene();
 
 	//Main window of the game, where everything appears.
 	SDL_Window* screen = NULL;
@@ -49,53 +85,278 @@ namespace ballgame
 	const int screen_width = 1024;
 	//Fixed height of the screen
 	const int screen_height = 768;
+	//Flags the main window is created with.
+	Uint32 windowFlags = SDL_WINDOW_SHOWN;
 	//Rendering object, generating images on canvas.
 	SDL_Renderer* gameRend = NULL;
 	
+	//Cache of textures loaded from files, emptied before the renderer is destroyed.
+	ResourceCache resources(16 * 1024 * 1024);
+
 	//Texture for ball rendering
-	LTexture ballTex;
+	shared_ptr<LTexture> ballTex;
 
 	//Main font
 	TTF_Font* mainFont = NULL;
+	//Glyphs of the main font, from which createText() draws.
+	TextAtlas textAtlas;
+	//Texture the scene is drawn into when it has its own resolution, see DynamicResolution.
+	SceneTarget sceneTarget;
 
-	//Rendered texture
-	LTexture gTextTexture;
+	//Path of the ball image.
+	const char* ballPath = "gamedata/img/ball.bmp";
 
-	//Loads texture using existing file image.
-	bool LTexture::loadFromFile(std::string path)
+	//Set on the thread running the simulation when rendering runs on another thread.
+	thread_local bool simulationThread = false;
+
+	//Returns whether the calling thread may draw: there is a renderer and it is not the simulation thread.
+	bool canRender()
 	{
-		//Destroys existing texture
-		free();
+		return gameRend != NULL && !simulationThread;
+	}
+
+	//Values shown in the HUD.
+	struct HudValues
+	{
+		int level = 0;
+		int vx = 0;
+		int vy = 0;
+		bool speedChangeX = false;
+		int health = 0;
+		int points = 0;
+	};
 
-		//The final texture
-		SDL_Texture* newTexture = NULL;
+	void renderHud(const HudValues& hud);
 
-		//Load image at specified path
-		SDL_Surface* loadedSurface = IMG_Load(path.c_str());
-		if (loadedSurface == NULL)
+	//Blocks the window thread until input comes or the simulation publishes a frame.
+	EventWaiter eventWaiter;
+
+	/**
+	Lets the main loop sleep in eventWaiter while the game is paused instead of waking every 15 ms,
+	and counts how often the game threads wake up.
+	**/
+	class IdleScheduler
+	{
+	public:
+		//Longest time a paused loop sleeps without any event, in ms.
+		int idleTimeout = 1000;
+
+		//Returns whether the event means the player left the window (minimized or focus lost).
+		bool isSuspendEvent(const SDL_Event& e)
 		{
-			printf("Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError());
+			if (e.type != SDL_WINDOWEVENT) return false;
+			return e.window.event == SDL_WINDOWEVENT_MINIMIZED || e.window.event == SDL_WINDOWEVENT_FOCUS_LOST;
 		}
-		else
+
+		//Starts measuring, called when the main loop starts.
+		void begin()
+		{
+			launch = SDL_GetPerformanceCounter();
+			measureStart = launch;
+		}
+
+		//Records one return of a game thread from sleeping; waits in eventWaiter count their own.
+		void countWakeup()
 		{
-			//Color key image
-			SDL_SetColorKey(loadedSurface, SDL_TRUE, SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
+			wakeups.fetch_add(1, memory_order_relaxed);
+		}
 
-			//Create texture from surface pixels
-			newTexture = SDL_CreateTextureFromSurface(gameRend, loadedSurface);
-			if (newTexture == NULL)
+		//Returns wakeups per second measured over the last full second.
+		double getWakeupsPerSecond()
+		{
+			Uint64 now = SDL_GetPerformanceCounter();
+			double elapsed = static_cast<double>(now - measureStart) / SDL_GetPerformanceFrequency();
+			if (elapsed >= 1)
 			{
-				printf("Unable to create texture from %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
+				unsigned long long count = getWakeups();
+				rate = (count - measuredWakeups) / elapsed;
+				measuredWakeups = count;
+				measureStart = now;
 			}
-			else
+			return rate;
+		}
+
+		//Prints wakeups counted since begin().
+		void report()
+		{
+			double elapsed = static_cast<double>(SDL_GetPerformanceCounter() - launch) / SDL_GetPerformanceFrequency();
+			unsigned long long count = getWakeups();
+			printf("Wakeups: %llu in %.1f s (%.1f per second)\n", count, elapsed, elapsed > 0 ? count / elapsed : 0.0);
+		}
+
+	private:
+		//Returns wakeups of all game threads.
+		unsigned long long getWakeups()
+		{
+			return wakeups.load(memory_order_relaxed) + eventWaiter.getWakeups();
+		}
+
+		atomic<unsigned long long> wakeups{ 0 };
+		unsigned long long measuredWakeups = 0;
+		Uint64 launch = 0;
+		Uint64 measureStart = 0;
+		double rate = 0;
+	};
+
+	//Sleep policy and wakeup counter of the game loops.
+	IdleScheduler idleScheduler;
+
+	/**
+	Chooses the scale of the internal resolution the scene is drawn at, see SceneTarget.
+	Frames slower than the budget lower the scale step by step; frames well within it raise the scale back to maxScale.
+	With nearest filtering the steps are 1, 1/2, 1/3..., so every pixel of the scene covers the same number of window pixels.
+	**/
+	class DynamicResolution
+	{
+	public:
+		//Defines whether the scene has its own resolution; set by --render-scale.
+		bool enabled = false;
+		//Scale the scene is drawn at while frames fit in the budget.
+		float maxScale = 1.0f;
+		//Defines whether the scene is stretched with linear filtering, otherwise the nearest pixel is repeated.
+		bool linear = true;
+		//Frame time the scene should fit in, in ms. 0 keeps the scale fixed.
+		double budgetMs = 12;
+
+		//Returns the lowest scale the resolution may drop to.
+		float getMinScale()
+		{
+			return min(maxScale, 0.5f);
+		}
+
+		//Returns scale for the next frames given how long the last frame drawn at scale took.
+		float update(float scale, double frameMs)
+		{
+			if (budgetMs <= 0) return scale;
+			averageMs += (frameMs - averageMs) * 0.1;
+			//Every change waits for the average to settle at the new scale
+			if (++framesSinceChange < settleFrames) return scale;
+			float next = scale;
+			if (averageMs > budgetMs) next = max(getMinScale(), stepDown(scale));
+			else if (averageMs < budgetMs / 2) next = min(maxScale, stepUp(scale));
+			if (next != scale) framesSinceChange = 0;
+			return next;
+		}
+
+	private:
+		//Returns the next lower scale: scaleStep lower, or the largest 1/n below scale with nearest filtering.
+		float stepDown(float scale)
+		{
+			if (linear) return scale - scaleStep;
+			if (scale > 1.0f) return 1.0f;
+			//Tolerance keeps a scale of exactly 1/n from being taken for a slightly lower one
+			int n = static_cast<int>(floor(1.0f / scale + 0.001f)) + 1;
+			return 1.0f / n;
+		}
+
+		//Returns the next higher scale: scaleStep higher, or the smallest 1/n above scale with nearest filtering.
+		float stepUp(float scale)
+		{
+			if (linear) return scale + scaleStep;
+			if (scale >= 1.0f) return maxScale;
+			int n = static_cast<int>(ceil(1.0f / scale - 0.001f)) - 1;
+			return 1.0f / n;
+		}
+
+		static constexpr float scaleStep = 0.125f;
+		static const int settleFrames = 60;
+		double averageMs = 0;
+		int framesSinceChange = 0;
+	};
+
+	//Internal resolution of the scene.
+	DynamicResolution resolution;
+
+	//Phase of the startup with its start and end in ms since launch.
+	struct StartupPhase
+	{
+		string name;
+		double start;
+		double end;
+	};
+
+	//Collects durations of startup phases, which may run on different threads.
+	class StartupTimeline
+	{
+	public:
+		//Sets the moment all times are measured from.
+		void begin()
+		{
+			origin = SDL_GetPerformanceCounter();
+		}
+
+		//Returns ms elapsed since begin().
+		double now()
+		{
+			return static_cast<double>(SDL_GetPerformanceCounter() - origin) * 1000 / SDL_GetPerformanceFrequency();
+		}
+
+		//Records finished phase.
+		void add(string name, double start, double end)
+		{
+			lock_guard<mutex> lock(phasesMutex);
+			phases.push_back({ name, start, end });
+		}
+
+		//Prints all phases in order of their start.
+		void print()
+		{
+			lock_guard<mutex> lock(phasesMutex);
+			sort(phases.begin(), phases.end(), [](const StartupPhase& a, const StartupPhase& b) { return a.start < b.start; });
+			printf("Startup timeline:\n");
+			for (const StartupPhase& phase : phases)
 			{
-				//Get image dimensions
-				mWidth = loadedSurface->w;
-				mHeight = loadedSurface->h;
+				printf("  %-22s %8.2f - %8.2f ms (%.2f ms)\n", phase.name.c_str(), phase.start, phase.end, phase.end - phase.start);
 			}
+		}
+
+	private:
+		Uint64 origin = 0;
+		vector<StartupPhase> phases;
+		mutex phasesMutex;
+	};
+
+	//Timeline of the current launch, printed once the first level is shown.
+	StartupTimeline startupTimeline;
+
+	//Loads texture using existing file image.
+	bool LTexture::loadFromFile(std::string path)
+	{
+		//Load image at specified path
+		SDL_Surface* loadedSurface = IMG_Load(path.c_str());
+		if (loadedSurface == NULL)
+		{
+			printf("Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError());
+			free();
+			return false;
+		}
+		bool success = loadFromSurface(loadedSurface);
+
+		//Get rid of old loaded surface
+		SDL_FreeSurface(loadedSurface);
+		return success;
+	}
+
+	//Creates texture from already decoded image; the surface stays owned by the caller.
+	bool LTexture::loadFromSurface(SDL_Surface* surface)
+	{
+		//Destroys existing texture
+		free();
+
+		//Color key image
+		SDL_SetColorKey(surface, SDL_TRUE, SDL_MapRGB(surface->format, 0, 0xFF, 0xFF));
 
-			//Get rid of old loaded surface
-			SDL_FreeSurface(loadedSurface);
+		//Create texture from surface pixels
+		SDL_Texture* newTexture = SDL_CreateTextureFromSurface(gameRend, surface);
+		if (newTexture == NULL)
+		{
+			printf("Unable to create texture from %s! SDL Error: %s\n", filePath.c_str(), SDL_GetError());
+		}
+		else
+		{
+			//Get image dimensions
+			mWidth = surface->w;
+			mHeight = surface->h;
 		}
 
 		//Return success
@@ -125,6 +386,15 @@ namespace ballgame
 		int alfa = 255;
 	};
 
+	//Text shown over the board while the game is paused.
+	enum class Message
+	{
+		None,
+		LevelBegin,
+		Won,
+		Lost
+	};
+
 	//Structure defining state of the ongoing gameplay.
 	struct GameState
 	{
@@ -140,6 +410,12 @@ namespace ballgame
 		int currentLevel = 1;
 		//Flag defining whether the game is paused or not.
 		bool pause = false;
+		//Number of frames simulated since the start of the game.
+		unsigned int ticks = 0;
+		//Text shown until the game is unpaused.
+		Message message = Message::None;
+		//Points shown with the end of game message.
+		int messagePoints = 0;
 		//Defines color of the text; default is white.
 		SDL_Color textColor = { 255, 255, 255 };
 		/**
@@ -152,8 +428,11 @@ namespace ballgame
 		}
 	};
 
-	//Main gameplay state object.
-	GameState gamestate;
+	/**
+	Main gameplay state object.
+	Like the ball, racket and blocks it is thread_local: every thread steps its own world, see swapWorld().
+	**/
+	thread_local GameState gamestate;
 
 	//Structure defining level block patterns.
 	struct Level
@@ -171,11 +450,25 @@ namespace ballgame
 		//Defines maximum any velocity in the level.
 		int vMax;
 
-		int row1[10];
-		int row2[10];
-		int row3[10];
-		int row4[10];
-		int row5[10];
+		//Number of block columns in the pattern.
+		int columns = 0;
+		//Number of block rows in the pattern.
+		int rows = 0;
+		//Starting resistance of every block, row after row. 0 means no block. Points into patternData or into the embedded table.
+		const int* pattern = NULL;
+		//Number of values in pattern: rows * columns.
+		int patternSize = 0;
+		//Pattern read from file, empty for embedded levels.
+		vector<int> patternData;
+
+		//Defines whether general information was already copied from level data.
+		bool infoLoaded = false;
+		//Defines whether the block pattern was already read from file.
+		bool patternLoaded = false;
+		//Rows per chunk of a tall level streamed from chunkFile while playing, 0 if the pattern is read at once.
+		int chunkRows = 0;
+		//File of the streamed level.
+		string chunkFile;
 	};
 
 	//Main array of levels, containing patterns of blocks for each level.
@@ -186,11 +479,8 @@ namespace ballgame
 	{
 	public:
 
-		Racket()
+		constexpr Racket() : width(200), height(20), pos(static_cast<int>(screen_width / 2) - static_cast<int>(width / 2))
 		{
-			width = 200;
-			height = 20;
-			pos = static_cast<int>(screen_width / 2) - static_cast<int>(width / 2);
 		}
 
 		//width of the racket
@@ -212,8 +502,6 @@ namespace ballgame
 		color mColor = {
 		255,255,0,255
 		};
-		//Texture where racket is drawn
-		SDL_Texture* mTex = SDL_CreateTexture(gameRend, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, screen_width, screen_height);
 
 		/**
 		Changes direction of the racket movement
@@ -247,29 +535,23 @@ namespace ballgame
 			}
 		};
 
-		//Renders the racket on its texture and draws it on canvas
+		//Draws the racket on canvas
 		void render()
 		{
 			SDL_Rect borderRect = { pos, screen_height - height - 10, width, height };
-			SDL_SetRenderTarget(gameRend, mTex);
 			setDrawColor(mColor.red, mColor.green, mColor.blue);
 			SDL_RenderFillRect(gameRend, &borderRect);
-			SDL_RenderCopy(gameRend, mTex, NULL, &borderRect);
-			SDL_SetRenderTarget(gameRend, NULL);
 		};
 	};
 
 	//Main racket steered by the player.
-	Racket racket = Racket();
+	thread_local Racket racket;
 
 	//Defines the ball objects.
 	class Ball {
 	public:
-		Ball()
+		constexpr Ball() : radius(10), posX(static_cast<int>(screen_width / 2)), posY(static_cast<int>(screen_height / 1.75))
 		{
-			radius = 10;
-			posX = static_cast<int>(screen_width / 2);
-			posY = static_cast<int>(screen_height / 1.75);
 		}
 		//The radius of the ball.
 		int radius;
@@ -330,7 +612,11 @@ namespace ballgame
 					if (!gamestate.speedChangeX)
 					{
 						if (avy < levels[gamestate.getLevel()].vMax) vy++;
-						else vy -= 4;
+						else
+						{
+							vy -= 4;
+							emitTelemetry(TelemetryEvent::VMaxClamp, gamestate.currentLevel, vx, vy, 0, gamestate.points);
+						}
 
 						//if (avx >= 11) vx--;
 						//if (avx < 4) vx++;
@@ -344,6 +630,7 @@ namespace ballgame
 						else {
 							if (vx >= 0) vx -= 4;
 							if (vx < 0) vx += 4;
+							emitTelemetry(TelemetryEvent::VMaxClamp, gamestate.currentLevel, vx, vy, 1, gamestate.points);
 						}
 
 						//if (avy >= 11) vy--;
@@ -368,6 +655,7 @@ namespace ballgame
 
 					gamestate.health--;
 					gamestate.points -= 10;
+					emitTelemetry(TelemetryEvent::LifeLost, gamestate.currentLevel, gamestate.health, 0, 0, gamestate.points);
 					if (gamestate.health <= 0)
 					{
 						handleEndLevel();
@@ -375,6 +663,7 @@ namespace ballgame
 
 				}
 				posY += vy;
+				emitTelemetry(TelemetryEvent::BallMove, gamestate.currentLevel, vx, vy, 1, gamestate.points);
 			}
 
 		}
@@ -382,14 +671,14 @@ namespace ballgame
 		//renders ball on its position
 		void render()
 		{
-			ballTex.render(posX, posY);
+			ballTex->render(posX, posY);
 		}
 
 
 	};
 
 	//Main ball of the game, bounced by the racket.
-	Ball ball = Ball();
+	thread_local Ball ball;
 
 	//Defines the block objects hit by the ball.
 	class Block
@@ -447,22 +736,204 @@ namespace ballgame
 		color mColor = {
 		0,255,0,255
 		};
-		//Texture where block is drawn
-		SDL_Texture* mTex = SDL_CreateTexture(gameRend, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, screen_width, screen_height);
-		//Renders the block on its texture and draws it on canvas
-		void render()
+		//Draws the block on canvas, with the board scrolled by given number of pixels
+		void render(int scroll)
 		{
-			SDL_Rect borderRect = { posX, posY, width, height };
-			SDL_SetRenderTarget(gameRend, mTex);
+			SDL_Rect borderRect = { posX, posY - scroll, width, height };
 			setDrawColor(mColor.red, mColor.green, mColor.blue);
 			SDL_RenderFillRect(gameRend, &borderRect);
-			SDL_RenderCopy(gameRend, mTex, NULL, NULL);
-			SDL_SetRenderTarget(gameRend, NULL);
 		};
 	};
 
 	//Array containing blocks of ongoing level.
-	Block gameBlocks[50];
+	thread_local vector<Block> gameBlocks;
+
+	//Range [begin, end) of indices in gameBlocks.
+	struct BlockRange
+	{
+		int begin;
+		int end;
+	};
+
+	//World y-position shown at the top edge of the screen. Blocks keep world positions; only streamed levels scroll.
+	thread_local int scrollY = 0;
+	//Ranges of gameBlocks on screen, the only blocks drawn and checked for hits.
+	thread_local vector<BlockRange> visibleBlocks;
+
+	//Change of resistance of a single block during one tick.
+	struct BlockDelta
+	{
+		//Index of the block in gameBlocks.
+		int id;
+		//Resistance before the change.
+		int before;
+	};
+
+	/**
+	State of the world at the end of a tick, without SDL handles and level data that never changes.
+	Block resistances are not stored; they are rebuilt by undoing BlockDelta entries recorded after the snapshot.
+	**/
+	struct WorldSnapshot
+	{
+		unsigned int ticks;
+		int points;
+		int health;
+		int currentLevel;
+		bool speedChangeX;
+
+		int ballX;
+		int ballY;
+		float ballVx;
+		float ballVy;
+		int ballJustBounced;
+		bool ballMoving;
+
+		int racketPos;
+		int racketWidth;
+		bool racketDir;
+		bool racketMoving;
+
+		int scrollY;
+
+		//Number of block changes recorded up to this tick.
+		unsigned long long deltaEnd;
+	};
+	static_assert(is_trivially_copyable<WorldSnapshot>::value, "snapshot must be copyable with memcpy");
+
+	/**
+	Ring buffer of snapshots of the last ticks of the ongoing level, used to rewind the game.
+	Block changes are journaled as they happen instead of copying all blocks every tick.
+	Buffers are allocated by the first recording, so threads that never record do not pay for them.
+	**/
+	class WorldHistory
+	{
+	public:
+		WorldHistory(int maxTicks, int maxDeltas) : maxTicks(maxTicks), maxDeltas(maxDeltas)
+		{
+		}
+
+		//Forgets all snapshots; called when blocks are redefined by loading a level.
+		void reset()
+		{
+			allocate();
+			snapshotCount = 0;
+			deltaCount = 0;
+		}
+
+		//Records change of resistance of a block; must be called before the block is modified.
+		void recordBlockChange(int id, int before)
+		{
+			allocate();
+			deltas[deltaCount % deltas.size()] = { id, before };
+			deltaCount++;
+		}
+
+		//Stores state of the world at the end of the current tick.
+		void capture()
+		{
+			allocate();
+			WorldSnapshot& snap = snapshots[snapshotCount % snapshots.size()];
+			snap.ticks = gamestate.ticks;
+			snap.points = gamestate.points;
+			snap.health = gamestate.health;
+			snap.currentLevel = gamestate.currentLevel;
+			snap.speedChangeX = gamestate.speedChangeX;
+			snap.ballX = ball.posX;
+			snap.ballY = ball.posY;
+			snap.ballVx = ball.vx;
+			snap.ballVy = ball.vy;
+			snap.ballJustBounced = ball.justBounced;
+			snap.ballMoving = ball.isMoving;
+			snap.racketPos = racket.pos;
+			snap.racketWidth = racket.width;
+			snap.racketDir = racket.dir;
+			snap.racketMoving = racket.isMoving;
+			snap.scrollY = scrollY;
+			snap.deltaEnd = deltaCount;
+			snapshotCount++;
+		}
+
+		//Number of snapshots that can be restored.
+		int size()
+		{
+			unsigned long long available = snapshotCount < snapshots.size() ? snapshotCount : snapshots.size();
+			return static_cast<int>(available);
+		}
+
+		/**
+		Brings the world back to the state captured given number of ticks ago (0 - the latest snapshot).
+		Snapshots newer than the restored one are dropped. Returns false if it is not in the history.
+		**/
+		bool restore(int ticksBack)
+		{
+			if (ticksBack < 0 || ticksBack >= size()) return false;
+			const WorldSnapshot& snap = snapshots[(snapshotCount - 1 - ticksBack) % snapshots.size()];
+			//Block changes older than the journal can hold are lost
+			if (deltaCount - snap.deltaEnd > deltas.size()) return false;
+
+			while (deltaCount > snap.deltaEnd)
+			{
+				deltaCount--;
+				const BlockDelta& delta = deltas[deltaCount % deltas.size()];
+				gameBlocks[delta.id].resistanceNow = delta.before;
+			}
+
+			gamestate.ticks = snap.ticks;
+			gamestate.points = snap.points;
+			gamestate.health = snap.health;
+			gamestate.currentLevel = snap.currentLevel;
+			gamestate.speedChangeX = snap.speedChangeX;
+			ball.posX = snap.ballX;
+			ball.posY = snap.ballY;
+			ball.vx = snap.ballVx;
+			ball.vy = snap.ballVy;
+			ball.justBounced = snap.ballJustBounced;
+			ball.isMoving = snap.ballMoving;
+			racket.pos = snap.racketPos;
+			racket.width = snap.racketWidth;
+			racket.dir = snap.racketDir;
+			racket.isMoving = snap.racketMoving;
+			//Resident chunks are the same as in the snapshot, since changing them resets the history
+			scrollY = snap.scrollY;
+			updateVisibleBlocks();
+			setTelemetryTick(gamestate.ticks);
+
+			snapshotCount -= ticksBack;
+			return true;
+		}
+
+	private:
+		void allocate()
+		{
+			if (!snapshots.empty()) return;
+			snapshots.resize(maxTicks);
+			deltas.resize(maxDeltas);
+		}
+
+		int maxTicks;
+		int maxDeltas;
+		vector<WorldSnapshot> snapshots;
+		vector<BlockDelta> deltas;
+		//Number of snapshots captured since the last reset.
+		unsigned long long snapshotCount = 0;
+		//Number of block changes recorded since the last reset.
+		unsigned long long deltaCount = 0;
+	};
+
+	//History of the last 10 seconds of the ongoing level.
+	thread_local WorldHistory history(660, 4096);
+	/**
+	Defines whether the calling thread records its world into history. Batch workers step many unrelated worlds,
+	so they turn it off and the history of their thread is never allocated.
+	**/
+	thread_local bool recordHistory = true;
+	//Number of ticks rewound by pressing R.
+	const int rewindTicks = 120;
+
+	//Frames drawn since a level was loaded.
+	thread_local int framesSinceLoad = 0;
+	//Frames after loading a level in which buffers and caches grow to their steady size; later frames must not allocate.
+	const int allocationWarmupFrames = 60;
 
 	//Changes color of the renderer drawing
 	void setDrawColor(int r, int g, int b)
@@ -470,25 +941,50 @@ namespace ballgame
 		SDL_SetRenderDrawColor(gameRend, r, g, b, 0);
 	}
 
+	//Starts drawing the scene, into the scene target if there is one, and clears it.
+	void beginScene()
+	{
+		sceneTarget.begin(gameRend);
+		setDrawColor(0, 0, 0);
+		SDL_RenderClear(gameRend);
+	}
+
+	//Stretches the scene over the window if it has its own resolution; text drawn afterwards has the resolution of the window.
+	void endScene()
+	{
+		sceneTarget.end(gameRend);
+	}
+
+	//Adapts the internal resolution of the scene to the time the last frame took.
+	void adaptRenderScale(double frameMs)
+	{
+		if (!sceneTarget.isCreated()) return;
+		float scale = resolution.update(sceneTarget.getScale(), frameMs);
+		if (scale != sceneTarget.getScale()) sceneTarget.create(gameRend, screen_width, screen_height, scale, resolution.linear);
+	}
+
+#ifdef BALLGAME_EMBEDDED_LEVELS
+	//General data of each level, parsed at compile time.
+	const int (&rawleveldata)[4][6] = embedded::levelTables.info;
+#else
 	//Array containing general data (like amount of blocks, starting ball speed) for each level. It can be load using loadLevelData()
 	int rawleveldata[4][6] = { };
+#endif
 
+#ifndef BALLGAME_EMBEDDED_LEVELS
 	//Parses data from level data file
-	void splitStringData(string text, char ch, int id)
+	void splitStringData(const string& text, char ch, int id)
 	{
-		int number;
-		string cur = "";
 		int properties = 0;
+		//Start of the number being read
+		int start = 0;
 		for (int i = 0; i < text.size(); i++)
 		{
-			if (text[i] != ch) cur += text[i];
-			else
-			{
-				number = stoi(cur);
-				cur = "";
-				rawleveldata[id][properties] = number;
-				properties++;
-			}
+			if (text[i] != ch) continue;
+			//Values past the known properties are ignored
+			if (properties < 6) rawleveldata[id][properties] = atoi(text.c_str() + start);
+			properties++;
+			start = i + 1;
 		}
 		
 	}
@@ -508,28 +1004,31 @@ namespace ballgame
 		}
 		return true;
 	}
+#else
+	//Level data is embedded in the executable, there is nothing to load.
+	bool loadLevelData()
+	{
+		return true;
+	}
+#endif
 
 	//Parses data from file and puts it to the data of level
-	void splitStringLevels(string text, char ch, int row, int id)
+	void splitStringLevels(const string& text, char ch, int row, int id)
 	{
-		int number;
-		string cur = "";
 		int properties = 0;
+		//Start of the number being read
+		int start = 0;
 		for (int i = 0; i < text.size(); i++)
 		{
-			if (text[i] != ch) cur += text[i];
-			else
-			{
-				number = stoi(cur);
-				cur = "";
-				if (row == 1) levels[id].row1[properties] = number;
-				else if (row == 2) levels[id].row2[properties] = number;
-				else if (row == 3) levels[id].row3[properties] = number;
-				else if (row == 4) levels[id].row4[properties] = number;
-				else if (row == 5) levels[id].row5[properties] = number;
-				properties++;
-			}
+			if (text[i] != ch) continue;
+			levels[id].patternData.push_back(atoi(text.c_str() + start));
+			properties++;
+			start = i + 1;
 		}
+		//First row defines the width of the board, other rows are padded or cut to it.
+		if (row == 1) levels[id].columns = properties;
+		else levels[id].patternData.resize(row * levels[id].columns);
+		levels[id].rows = row;
 
 	}
 
@@ -537,6 +1036,8 @@ namespace ballgame
 	bool loadLevelInfo(int levelnumber)
 	{
 		levelnumber--;
+		//Level data does not change during the game, so it is copied only once.
+		if (levels[levelnumber].infoLoaded) return true;
 
 		levels[levelnumber].id = rawleveldata[levelnumber][0]; //load id of the level
 		levels[levelnumber].rowsHeight = rawleveldata[levelnumber][1]; //loads number of rows
@@ -544,44 +1045,289 @@ namespace ballgame
 		levels[levelnumber].vxIni = rawleveldata[levelnumber][3]; //loads x-velocity
 		levels[levelnumber].vyIni = rawleveldata[levelnumber][4]; //loads y-velocity
 		levels[levelnumber].vMax = rawleveldata[levelnumber][5]; //loads max velocity
+		levels[levelnumber].infoLoaded = true;
 		return true;
 	}
 
-	//Loads from file block pattern of chosen level - as an argument it takes the level's id.
-	bool loadLevelPattern(int levelnumber)
+	//Loads block pattern from given file to the level of given array id.
+	bool loadLevelPatternFile(const string& filename, int id)
 	{
+		//Tall levels are not read at once, but chunk by chunk while playing
+		levels[id].chunkRows = LevelStream::readChunkRows(filename);
+		if (levels[id].chunkRows > 0)
+		{
+			levels[id].chunkFile = filename;
+			//Release memory of a pattern loaded before
+			levels[id].patternData = vector<int>();
+			levels[id].pattern = NULL;
+			levels[id].patternSize = 0;
+			levels[id].patternLoaded = true;
+			return true;
+		}
 		fstream file;
-		string filename = "gamedata/levels/level" + to_string(levelnumber) + ".txt";
-		levelnumber--;
 		file.open(filename, ios::in);
 		if (!file.is_open()) return false;
+		levels[id].patternData.clear();
+		levels[id].columns = 0;
+		levels[id].rows = 0;
 		string line = "";
 		int linecount = 1;
 		while (getline(file, line))
 		{
-			splitStringLevels(line, '_', linecount, levelnumber);
+			if (line.empty()) continue;
+			splitStringLevels(line, '_', linecount, id);
 			linecount++;
 		}
+		levels[id].pattern = levels[id].patternData.data();
+		levels[id].patternSize = static_cast<int>(levels[id].patternData.size());
+		levels[id].patternLoaded = true;
+		return true;
+	}
+
+	//Loads from file block pattern of chosen level - as an argument it takes the level's id.
+	bool loadLevelPattern(int levelnumber)
+	{
+		//Pattern does not change during the game, so it is read from disk only once.
+		if (levels[levelnumber - 1].patternLoaded) return true;
+#ifdef BALLGAME_EMBEDDED_LEVELS
+		//Blocks are defined straight from the table compiled into the executable
+		const embedded::LevelPattern& table = embedded::levelTables.patterns[levelnumber - 1];
+		Level& level = levels[levelnumber - 1];
+		level.rows = table.rows;
+		level.columns = table.columns;
+		level.pattern = table.resistances;
+		level.patternSize = table.rows * table.columns;
+		level.patternLoaded = true;
+		return true;
+#else
+		string filename = "gamedata/levels/level" + to_string(levelnumber) + ".txt";
+		return loadLevelPatternFile(filename, levelnumber - 1);
+#endif
+	}
+
+	//Loader of the ongoing level if it is streamed. Shared by all threads, so only one world may play a streamed level.
+	LevelStream levelStream;
+	//Chunk held by every slot of gameBlocks, -1 for a free slot. Empty unless the ongoing level is streamed.
+	thread_local vector<int> chunkSlots;
+	//Number of blocks in one slot: rows per chunk * columns.
+	thread_local int slotBlocks = 0;
+	//Lowest block of a streamed level is scrolled to this row of the screen, the last one of ordinary levels.
+	const int streamedViewRows = 10;
+	//Pixels a streamed level scrolls per tick.
+	const int scrollSpeed = 2;
+
+	//Returns whether the ongoing level is streamed in chunks.
+	bool isStreamed()
+	{
+		return !chunkSlots.empty();
+	}
+
+	//Returns world y-position of the top of given chunk.
+	int chunkTop(int chunk)
+	{
+		return 60 + 35 * chunk * levelStream.getChunkRows();
+	}
+
+	//Returns world y-position of the bottom edge of the last row of given chunk.
+	int chunkBottom(int chunk)
+	{
+		return chunkTop(chunk + 1) - 5;
+	}
+
+	//Returns index of the chunk at given world y-position.
+	int chunkAt(int y)
+	{
+		int chunk = max(0, y - 60) / 35 / levelStream.getChunkRows();
+		return min(chunk, levelStream.getChunkCount() - 1);
+	}
+
+	//Returns whether any part of given chunk is on screen.
+	bool chunkVisible(int chunk)
+	{
+		return chunkBottom(chunk) > scrollY && chunkTop(chunk) < scrollY + screen_height;
+	}
+
+	//Returns slot holding given chunk, or -1 if it is not resident.
+	int slotOf(int chunk)
+	{
+		for (int slot = 0; slot < static_cast<int>(chunkSlots.size()); slot++)
+		{
+			if (chunkSlots[slot] == chunk) return slot;
+		}
+		return -1;
+	}
+
+	//Returns whether all blocks of given slot are destroyed.
+	bool slotCleared(int slot)
+	{
+		for (int i = slot * slotBlocks; i < (slot + 1) * slotBlocks; i++)
+		{
+			if (gameBlocks[i].resistanceNow != 0) return false;
+		}
+		return true;
+	}
+
+	/**
+	Puts chunk read by the loader into a free slot. Returns false if there is none.
+	The rewind history refers to blocks by index, so it is reset and cannot reach past the change.
+	**/
+	bool installChunk(const LevelChunk& chunk)
+	{
+		int slot = slotOf(-1);
+		if (slot < 0) return false;
+		int columns = levelStream.getColumns();
+		int firstRow = chunk.index * levelStream.getChunkRows();
+		for (int i = 0; i < slotBlocks; i++)
+		{
+			Block& block = gameBlocks[slot * slotBlocks + i];
+			block.width = 90;
+			block.height = 30;
+			block.posX = 40 + 95 * (i % columns);
+			block.posY = 60 + 35 * (firstRow + i / columns);
+			block.resistanceNow = chunk.resistances[i];
+		}
+		chunkSlots[slot] = chunk.index;
+		if (recordHistory) history.reset();
 		return true;
 	}
 
+	//Rebuilds the list of block ranges on screen.
+	void updateVisibleBlocks()
+	{
+		visibleBlocks.clear();
+		if (!isStreamed())
+		{
+			visibleBlocks.push_back({ 0, static_cast<int>(gameBlocks.size()) });
+			return;
+		}
+		for (int slot = 0; slot < static_cast<int>(chunkSlots.size()); slot++)
+		{
+			if (chunkSlots[slot] < 0 || !chunkVisible(chunkSlots[slot])) continue;
+			visibleBlocks.push_back({ slot * slotBlocks, (slot + 1) * slotBlocks });
+		}
+	}
+
+	/**
+	Keeps resident the chunks on screen and one chunk above it, where the level scrolls next.
+	Cleared chunks below the screen are evicted and missing chunks are requested from the loader thread;
+	the game waits for the loader only if a chunk on screen is still missing.
+	**/
+	void updateStreaming()
+	{
+		if (!isStreamed()) return;
+		for (int slot = 0; slot < static_cast<int>(chunkSlots.size()); slot++)
+		{
+			int chunk = chunkSlots[slot];
+			if (chunk >= 0 && chunkTop(chunk) >= scrollY + screen_height && slotCleared(slot))
+			{
+				chunkSlots[slot] = -1;
+				if (recordHistory) history.reset();
+			}
+		}
+
+		int first = chunkAt(scrollY - 35 * levelStream.getChunkRows());
+		//Evicted chunks start at the bottom edge or below, so they are never requested again
+		int last = chunkAt(scrollY + screen_height - 1);
+		for (int chunk = first; chunk <= last; chunk++)
+		{
+			if (slotOf(chunk) < 0) levelStream.request(chunk);
+		}
+
+		LevelChunk chunk;
+		while (levelStream.take(chunk, false)) installChunk(chunk);
+		for (int visible = chunkAt(scrollY); visible <= last; visible++)
+		{
+			while (slotOf(visible) < 0 && levelStream.take(chunk, true)) installChunk(chunk);
+		}
+		updateVisibleBlocks();
+	}
+
+	//Returns the lowest row with a block left in resident chunks, or -1 if there is none.
+	int lowestBlockRow()
+	{
+		int lowest = -1;
+		int chunkRows = levelStream.getChunkRows();
+		for (int slot = 0; slot < static_cast<int>(chunkSlots.size()); slot++)
+		{
+			if (chunkSlots[slot] < 0) continue;
+			int firstRow = chunkSlots[slot] * chunkRows;
+			if (firstRow + chunkRows - 1 <= lowest) continue;
+			//Searching from the end finds the lowest block of the chunk first
+			for (int i = (slot + 1) * slotBlocks - 1; i >= slot * slotBlocks; i--)
+			{
+				if (gameBlocks[i].resistanceNow == 0) continue;
+				lowest = max(lowest, firstRow + (i - slot * slotBlocks) / levelStream.getColumns());
+				break;
+			}
+		}
+		return lowest;
+	}
+
+	/**
+	Returns scroll position the streamed level moves to, which puts its lowest block left into the last row of an ordinary level.
+	Chunks below the screen are cleared, so the board only scrolls up.
+	**/
+	int scrollTarget()
+	{
+		int row = lowestBlockRow();
+		if (row >= 0) return min(scrollY, max(0, 35 * (row - streamedViewRows + 1)));
+		//Resident chunks are cleared, so scroll on to the next ones
+		return max(0, scrollY - scrollSpeed);
+	}
+
+	//Scrolls streamed level towards scrollTarget() and updates resident chunks.
+	void scrollLevel()
+	{
+		if (!isStreamed()) return;
+		scrollY = max(scrollTarget(), scrollY - scrollSpeed);
+		updateStreaming();
+	}
+
+	//Opens streamed level of given array id and loads the chunks at its bottom, where the game starts.
+	void defineStreamedBlocks(int id)
+	{
+		chunkSlots.clear();
+		gameBlocks.clear();
+		if (!levelStream.open(levels[id].chunkFile))
+		{
+			printf("Failed to open streamed level %s!\n", levels[id].chunkFile.c_str());
+			updateVisibleBlocks();
+			return;
+		}
+		slotBlocks = levelStream.getChunkRows() * levelStream.getColumns();
+		//Enough slots for chunks on screen, the one above it and a cleared one below waiting for eviction
+		chunkSlots.assign(screen_height / (35 * levelStream.getChunkRows()) + 4, -1);
+		Block empty;
+		empty.resistanceNow = 0;
+		//New vector releases capacity left by a larger board
+		gameBlocks = vector<Block>(chunkSlots.size() * slotBlocks, empty);
+		scrollY = max(0, 35 * (levelStream.getRows() - streamedViewRows));
+		updateStreaming();
+	}
+
 	//Create blocks using level's pattern.
 	void defineBlocks(int levelid)
 	{
 		levelid--;
+		if (levels[levelid].chunkRows > 0)
+		{
+			defineStreamedBlocks(levelid);
+			return;
+		}
+		if (isStreamed()) levelStream.close();
+		chunkSlots.clear();
+		scrollY = 0;
+		int columns = levels[levelid].columns;
+		gameBlocks.assign(levels[levelid].patternSize, Block());
 		int resistance = 0;
 		int blockid = 0;
-		for (int row = 1; row <= 5; row++)
+		for (int row = 1; row <= levels[levelid].rows; row++)
 		{
-			for (int column = 0; column < 10; column++)
+			for (int column = 0; column < columns; column++)
 			{
-				if (row == 1) resistance = levels[levelid].row1[column];
-				else if (row == 2) resistance = levels[levelid].row2[column];
-				else if (row == 3) resistance = levels[levelid].row3[column];
-				else if (row == 4) resistance = levels[levelid].row4[column];
-				else if (row == 5) resistance = levels[levelid].row5[column];
+				blockid = ((row - 1) * columns) + column;
+				resistance = levels[levelid].pattern[blockid];
 
-				blockid = ((row - 1) * 10) + column;
 				gameBlocks[blockid].width = 90;
 				gameBlocks[blockid].height = 30;
 				gameBlocks[blockid].posX = 40 + 95 * column;
@@ -589,6 +1335,7 @@ namespace ballgame
 				gameBlocks[blockid].resistanceNow = resistance;
 			}
 		}
+		updateVisibleBlocks();
 
 	}
 
@@ -602,6 +1349,8 @@ namespace ballgame
 			return false;
 		}
 		defineBlocks(levelid);
+		if (recordHistory) history.reset();
+		framesSinceLoad = 0;
 
 
 		//cout << levels[levelid - 1].id << endl;
@@ -622,168 +1371,239 @@ namespace ballgame
 
 	}
 
-	//Renders all blocks of level and checks if all of them are destroyed.
+	//Returns color of a block of given resistance.
+	color resistanceColor(int resistance)
+	{
+		switch (resistance)
+		{
+		case 2:
+			return { 51, 153, 102,255 };
+		case 3:
+			return { 0, 153, 255 , 255 };
+		case 4:
+			return { 51, 51, 255 , 255 };
+		case 5:
+			return { 204, 51, 25 , 255 };
+		default:
+			return { 0,255,0,255 };
+		}
+	}
+
+	//Renders blocks on screen and checks if all of them are destroyed.
 	bool renderBlocks()
 	{
 		bool levelDone = true;
-		for (int i = 0; i < 50; i++)
+		for (const BlockRange& range : visibleBlocks)
 		{
-			if (gameBlocks[i].resistanceNow == 0) continue;
-			else levelDone = false;
-			switch (gameBlocks[i].resistanceNow)
+			for (int i = range.begin; i < range.end; i++)
 			{
-			case 1:
-				gameBlocks[i].mColor = {0,255,0,255};
-				break;
-			case 2:
-				gameBlocks[i].mColor = { 51, 153, 102,255 };
-				break;
-			case 3:
-				gameBlocks[i].mColor = { 0, 153, 255 , 255 };
-				break;
-			case 4:
-				gameBlocks[i].mColor = { 51, 51, 255 , 255 };
-				break;
-			case 5:
-				gameBlocks[i].mColor = { 204, 51, 25 , 255 };
-				break;
+				if (gameBlocks[i].resistanceNow == 0) continue;
+				else levelDone = false;
+				gameBlocks[i].mColor = resistanceColor(gameBlocks[i].resistanceNow);
+				gameBlocks[i].render(scrollY);
 			}
-			gameBlocks[i].render();
 		}
 		return levelDone;
 	}
 
-	//Creates text to renderer in given color, font, dimensions and coordinates.
-	void createText(std::string textureText, SDL_Color textColor, TTF_Font* font, int w, int h, int x, int y)
+	//Draws text in given color, stretched to given dimensions and coordinates.
+	void createText(const char* text, SDL_Color textColor, int w, int h, int x, int y)
 	{
-		SDL_Surface* texSurface = TTF_RenderText_Solid(font, textureText.c_str(), textColor);
-		SDL_Texture* tex = SDL_CreateTextureFromSurface(gameRend, texSurface);
-		SDL_Rect tex_rect;
-		tex_rect.w = w;
-		tex_rect.h = h;
-		tex_rect.x = x;
-			tex_rect.y = y;
-		SDL_SetRenderTarget(gameRend, tex);
-		
-		SDL_RenderCopy(gameRend, tex, NULL, &tex_rect);
-		SDL_SetRenderTarget(gameRend, NULL);
-
-		SDL_FreeSurface(texSurface);
-		SDL_DestroyTexture(tex);
-
+		//Nothing to draw on in headless runs or on the simulation thread
+		if (!canRender() || !textAtlas.isCreated()) return;
+		SDL_Rect box = { x, y, w, h };
+		textAtlas.render(gameRend, text, textColor, box);
 	}
 
 	//Generates level starting text
 	void levelBeginText(int levelid)
 	{
-		string text = "level " + to_string(levelid);
+		gamestate.message = Message::LevelBegin;
+		gamestate.pause = true;
+		if (!canRender()) return;
+		endScene();
+		drawLevelBeginText(levelid);
+		SDL_RenderPresent(gameRend);
+	}
+
+	//Draws level starting text
+	void drawLevelBeginText(int levelid)
+	{
+		char text[32];
+		snprintf(text, sizeof(text), "level %d", levelid);
 		int w = 300; 
 		int h = 100; 
 		int x = int(screen_width / 2) - int(w / 2); 
 		int y = int(screen_height / 2) - int(h / 2);
-		createText(text, gamestate.textColor, mainFont, w , h , x , y);
-		createText("tuvrai | ballgame v1.0", gamestate.textColor, mainFont, 150, 15, 5, screen_height-20);
-		gamestate.pause = true;
-		SDL_RenderPresent(gameRend);
+		createText(text, gamestate.textColor, w , h , x , y);
+		createText("tuvrai | ballgame v1.0", gamestate.textColor, 150, 15, 5, screen_height-20);
 	}
 
 	void levelEndText(bool isWin)
 	{
-		string text;
-		if (isWin) text = "Congratulations! You won.";
-		else text = "You lost. Try again.";
+		gamestate.message = isWin ? Message::Won : Message::Lost;
+		gamestate.messagePoints = gamestate.points;
+		if (!canRender()) return;
+		endScene();
+		drawLevelEndText(isWin, gamestate.points);
+		SDL_RenderPresent(gameRend);
+	}
+
+	//Draws end of game text with scored points
+	void drawLevelEndText(bool isWin, int points)
+	{
+		const char* result;
+		if (isWin) result = "Congratulations! You won.";
+		else result = "You lost. Try again.";
 		int w = 400;
 		int h = 100;
 		int x = int(screen_width / 2) - int(w / 2);
 		int y = int(screen_height / 2) - int(h / 2);
-		createText(text, gamestate.textColor, mainFont, w, h, x, y);
-		text = "Points: " + to_string(gamestate.points);
-		createText(text, gamestate.textColor, mainFont, w, h, x, y+120);
-		SDL_RenderPresent(gameRend);
+		createText(result, gamestate.textColor, w, h, x, y);
+		char text[32];
+		snprintf(text, sizeof(text), "Points: %d", points);
+		createText(text, gamestate.textColor, w, h, x, y+120);
+	}
+
+	//Returns values shown in the HUD.
+	HudValues currentHud()
+	{
+		HudValues hud;
+		hud.level = gamestate.currentLevel;
+		hud.vx = static_cast<int>(ball.vx);
+		hud.vy = static_cast<int>(ball.vy);
+		hud.speedChangeX = gamestate.speedChangeX;
+		hud.health = gamestate.health;
+		hud.points = gamestate.points;
+		return hud;
 	}
 
 	//Renders HUD if enabled.
 	void renderHud()
 	{
-		string temptext;
-		temptext = "level:    " + to_string(gamestate.currentLevel);
-		createText(temptext, gamestate.textColor, mainFont, 120, 20, 5, screen_height-150);
-		temptext = "x-velocity: " + to_string(static_cast<int>(ball.vx));
-		createText(temptext, gamestate.textColor, mainFont, 120, 20, 5, screen_height - 130);
-		temptext = "y-velocity: " + to_string(static_cast<int>(ball.vy));
-		createText(temptext, gamestate.textColor, mainFont, 120, 20, 5, screen_height - 110);
-		string foc = (gamestate.speedChangeX) ? "x" : "y";
-		temptext = "focus: " + foc;
-		createText(temptext, gamestate.textColor, mainFont, 80, 20, 5, screen_height - 90);
-		temptext = "health: " + to_string(gamestate.health);
-		createText(temptext, gamestate.textColor, mainFont, 80, 20, 5, screen_height - 70);
-		temptext = "points: " + to_string(gamestate.points);
-		createText(temptext, gamestate.textColor, mainFont, 80, 20, 5, screen_height - 50);
-	}
-
-	//Checks if the ball has hit any of the blocks and reacts to that if necessary.
+		renderHud(currentHud());
+	}
+
+	//Renders HUD showing given values. Texts are formatted into a fixed buffer, so it does not allocate.
+	void renderHud(const HudValues& hud)
+	{
+		char temptext[32];
+		snprintf(temptext, sizeof(temptext), "level:    %d", hud.level);
+		createText(temptext, gamestate.textColor, 120, 20, 5, screen_height-150);
+		snprintf(temptext, sizeof(temptext), "x-velocity: %d", hud.vx);
+		createText(temptext, gamestate.textColor, 120, 20, 5, screen_height - 130);
+		snprintf(temptext, sizeof(temptext), "y-velocity: %d", hud.vy);
+		createText(temptext, gamestate.textColor, 120, 20, 5, screen_height - 110);
+		snprintf(temptext, sizeof(temptext), "focus: %s", (hud.speedChangeX) ? "x" : "y");
+		createText(temptext, gamestate.textColor, 80, 20, 5, screen_height - 90);
+		snprintf(temptext, sizeof(temptext), "health: %d", hud.health);
+		createText(temptext, gamestate.textColor, 80, 20, 5, screen_height - 70);
+		snprintf(temptext, sizeof(temptext), "points: %d", hud.points);
+		createText(temptext, gamestate.textColor, 80, 20, 5, screen_height - 50);
+		snprintf(temptext, sizeof(temptext), "heap: %lld KB", getHeapBytes() / 1024);
+		createText(temptext, gamestate.textColor, 120, 20, 5, screen_height - 190);
+		snprintf(temptext, sizeof(temptext), "textures: %lld KB", getTextureBytes() / 1024);
+		createText(temptext, gamestate.textColor, 120, 20, 5, screen_height - 170);
+		snprintf(temptext, sizeof(temptext), "wakeups/s: %d", static_cast<int>(idleScheduler.getWakeupsPerSecond()));
+		createText(temptext, gamestate.textColor, 120, 20, 5, screen_height - 210);
+		snprintf(temptext, sizeof(temptext), "render scale: %d%%", static_cast<int>(sceneTarget.getScale() * 100 + 0.5f));
+		createText(temptext, gamestate.textColor, 120, 20, 5, screen_height - 230);
+	}
+
+	//Checks if the ball has hit any of the blocks on screen and reacts to that if necessary.
 	void checkBlocksHit()
 	{
-		bool done = false;
-		for (int i = 0; i < 50; i++)
-		{
-			if (gameBlocks[i].resistanceNow == 0) continue;
-			if (ball.posY - ball.radius <= gameBlocks[i].posY + gameBlocks[i].height &&
-				ball.posY + ball.radius >= gameBlocks[i].posY &&
-				ball.posX - ball.radius < gameBlocks[i].posX + gameBlocks[i].width &&
-				ball.posX + ball.radius > gameBlocks[i].posX)
-			{
-				gameBlocks[i].resistanceNow--;
-				//cout << ball.posX << " " << ball.radius << " " << gameBlocks[i].posX << " " << gameBlocks[i].width << endl;
-					//ball.vy = rint(0.9 * ball.vy);
-					//ball.vx = rint(0.9 * ball.vx);
-				gamestate.points++;
-					
+		//Bound once, so the loop does not check initialization of the thread_local vector on every block
+		vector<Block>& gameBlocks = ballgame::gameBlocks;
+		for (const BlockRange& range : visibleBlocks)
+		{
+			for (int i = range.begin; i < range.end; i++)
+			{
+				if (gameBlocks[i].resistanceNow == 0) continue;
+				int top = gameBlocks[i].posY - scrollY;
+				if (ball.posY - ball.radius <= top + gameBlocks[i].height &&
+					ball.posY + ball.radius >= top &&
+					ball.posX - ball.radius < gameBlocks[i].posX + gameBlocks[i].width &&
+					ball.posX + ball.radius > gameBlocks[i].posX)
+				{
+					if (recordHistory) history.recordBlockChange(i, gameBlocks[i].resistanceNow);
+					gameBlocks[i].resistanceNow--;
+					//cout << ball.posX << " " << ball.radius << " " << gameBlocks[i].posX << " " << gameBlocks[i].width << endl;
+						//ball.vy = rint(0.9 * ball.vy);
+						//ball.vx = rint(0.9 * ball.vx);
+					gamestate.points++;
+					emitTelemetry(TelemetryEvent::BlockHit, gamestate.currentLevel, i, gameBlocks[i].resistanceNow, 0, gamestate.points);
+
 					ball.vy = -ball.vy;
 					ball.posY += ball.vy;
 					return;
-				
+				}
+				/*else if (ball.posY - 5 >= gameBlocks[i].posY &&
+					ball.posY + 5 <= gameBlocks[i].posY + gameBlocks[i].height &&
+					( (ball.posX - ball.radius < gameBlocks[i].posX + gameBlocks[i].width && ball.posX + ball.radius > gameBlocks[i].posX && ball.vx < 0 ) ||
+					(ball.posX + ball.radius > gameBlocks[i].posX && ball.posX + ball.radius < gameBlocks[i].posX + gameBlocks[i].width && ball.vx>0)	))
+				{
+					cout << "$"<< ball.posY << " " << ball.vx << " " << i << gameBlocks[i].posX << " " << gameBlocks[i].posY << endl;
+					ball.vx = -ball.vx;
+					ball.posX += ball.vx;
+					return;
+				}*/
 			}
-			/*else if (ball.posY - 5 >= gameBlocks[i].posY &&
-				ball.posY + 5 <= gameBlocks[i].posY + gameBlocks[i].height &&
-				( (ball.posX - ball.radius < gameBlocks[i].posX + gameBlocks[i].width && ball.posX + ball.radius > gameBlocks[i].posX && ball.vx < 0 ) ||
-				(ball.posX + ball.radius > gameBlocks[i].posX && ball.posX + ball.radius < gameBlocks[i].posX + gameBlocks[i].width && ball.vx>0)	))
-			{
-				cout << "$"<< ball.posY << " " << ball.vx << " " << i << gameBlocks[i].posX << " " << gameBlocks[i].posY << endl;
-				ball.vx = -ball.vx;
-				ball.posX += ball.vx;
-				return;
-			}*/
 		}
 	}
 
 	void handleEndLevel()
 	{
+		emitTelemetry(TelemetryEvent::GameOver, gamestate.currentLevel, gamestate.currentLevel, 0, 0, gamestate.points);
 		gamestate.currentLevel = 1;
 		gamestate.hudVisible = false;
 		loadLevel(1);
-		setDrawColor(0, 0, 0);
-		SDL_RenderClear(gameRend);
+		if (canRender())
+		{
+			endScene();
+			setDrawColor(0, 0, 0);
+			SDL_RenderClear(gameRend);
+		}
 		levelEndText(false);
 		gamestate.points = 0;
 		gamestate.health = 3;
 		gamestate.pause = true;
 	}
 
-	//Initializes all SDL components (libraries, window, renderer, etc.).
-	bool init()
+	//Initializes SDL, SDL_image and SDL_ttf. They must not be used by worker threads before it returns.
+	bool initLibraries()
 	{
+		double start = startupTimeline.now();
 		if (SDL_Init(SDL_INIT_VIDEO) < 0)
 		{
 			printf("SDL could not initialize! SDL Error: %s\n", SDL_GetError());
 			return false;
 		}
+		int imgFlags = IMG_INIT_PNG;
+		if (!(IMG_Init(imgFlags) & imgFlags))
+		{
+			printf("SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError());
+			return false;
+		}
+		if (TTF_Init() == -1)
+		{
+			printf("SDL_ttf could not initialize! SDL_ttf Error: %s\n", TTF_GetError());
+			return false;
+		}
+		startupTimeline.add("SDL_Init", start, startupTimeline.now());
+		return true;
+	}
+
+	//Creates the window and the renderer.
+	bool createWindow()
+	{
+		double start = startupTimeline.now();
 		if (!SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1"))
 		{
 			printf("Warning: Linear texture filtering not enabled!");
 			return false;
 		}
-		screen = SDL_CreateWindow("ball game", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, screen_width, screen_height, SDL_WINDOW_SHOWN);
+		screen = SDL_CreateWindow("ball game", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, screen_width, screen_height, windowFlags);
 		if (screen == NULL)
 		{
 			printf("Window could not be created! SDL Error: %s\n", SDL_GetError());
@@ -795,37 +1615,65 @@ namespace ballgame
 			printf("Renderer could not be created! SDL Error: %s\n", SDL_GetError());
 			return false;
 		}
-
-		int imgFlags = IMG_INIT_PNG;
-		if (!(IMG_Init(imgFlags) & imgFlags))
-		{
-			printf("SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError());
-			return false;
-		}
-		if (TTF_Init() == -1)
-		{
-			printf("SDL_ttf could not initialize! SDL_ttf Error: %s\n", TTF_GetError());
-			return false;
-		}
+		startupTimeline.add("window and renderer", start, startupTimeline.now());
+		if (!eventWaiter.create()) printf("Warning: waiting for events falls back to polling!\n");
 
 		return true;
 	}
 
-	//Loads  all additional files like sound or images.
-	bool loadMedia()
+	//Initializes all SDL components (libraries, window, renderer, etc.). On failure close() frees what was created.
+	bool init()
+	{
+		return initLibraries() && createWindow();
+	}
+
+	//Decodes images. Runs on a worker thread after initLibraries(), so it must not touch the renderer.
+	SDL_Surface* decodeImages()
+	{
+		double start = startupTimeline.now();
+		SDL_Surface* surface = IMG_Load(ballPath);
+		if (surface == NULL) printf("Unable to load image %s! SDL_image Error: %s\n", ballPath, IMG_GetError());
+		startupTimeline.add("image decoding", start, startupTimeline.now());
+		return surface;
+	}
+
+	//Opens fonts. Runs on a worker thread after initLibraries().
+	TTF_Font* openFonts()
+	{
+		double start = startupTimeline.now();
+		//Text is never drawn higher than 100 px, so bigger glyphs would only be rasterized to be scaled down.
+		TTF_Font* font = TTF_OpenFont("gamedata/fonts/JosefinSans-Regular.ttf", 72);
+		startupTimeline.add("font loading", start, startupTimeline.now());
+		return font;
+	}
+
+	//Uploads decoded images to the renderer and takes over the font; both are freed even on failure. Must run on the main thread.
+	bool loadMedia(SDL_Surface* ballSurface, TTF_Font* font)
 	{
-		if (!ballTex.loadFromFile("gamedata/img/ball.bmp"))
+		double start = startupTimeline.now();
+		//Closed by close() whatever fails below
+		mainFont = font;
+		if (ballSurface == NULL)
+		{
+			printf("Failed to load images.\n");
+			return false;
+		}
+		//The cache frees the surface, also when the upload fails
+		ballTex = resources.getTexture(ballPath, ballSurface);
+		if (ballTex == nullptr)
 		{
 			printf("Failed to load images.\n");
 			return false;
 		}
 
-		mainFont = TTF_OpenFont("gamedata/fonts/JosefinSans-Regular.ttf",150);
-		if (mainFont == NULL)
+		if (mainFont == NULL || !textAtlas.create(gameRend, mainFont))
 		{
 			printf("Failed to load fonts.\n");
 			return false;
 		}
+		//Without the scene target the scene is drawn at the resolution of the window
+		if (resolution.enabled) sceneTarget.create(gameRend, screen_width, screen_height, resolution.maxScale, resolution.linear);
+		startupTimeline.add("texture upload", start, startupTimeline.now());
 		return true;
 	}
 	
@@ -833,70 +1681,423 @@ namespace ballgame
 	void close()
 	{
 		//Free media
-		ballTex.free();
+		ballTex = nullptr;
+		resources.clear();
+		textAtlas.free();
+		TTF_CloseFont(mainFont);
+		mainFont = NULL;
+		sceneTarget.free();
+		eventWaiter.destroy();
 		//Destroy window	
 		SDL_DestroyRenderer(gameRend);
 		SDL_DestroyWindow(screen);
 		screen = NULL;
 		gameRend = NULL;
 
-		delete racket.mTex;
-
 		//Quit SDL subsystems
 		IMG_Quit();
 		SDL_Quit();
 		TTF_Quit();
 	}
 
+	//Returns seconds elapsed since given performance counter value.
+	double secondsSince(Uint64 start)
+	{
+		return static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+	}
+
+	//Steers the racket towards the predicted landing point of the ball.
+	class Autopilot
+	{
+	public:
+		//Defines whether the autopilot controls the racket.
+		bool enabled = false;
+		//Accuracy from 0 (misses by up to the racket width) to 1 (always aims at the racket center).
+		double skill = 0.9;
+
+		/**
+		Predicts x-position of the ball when it reaches the racket line, reflecting it from the side walls like Ball::move().
+		A rising ball is followed up to the top edge and back. Blocks are not taken into account.
+		**/
+		int predictLandingX()
+		{
+			if (ball.vy == 0) return ball.posX;
+			double line = screen_height - 15 - racket.height - 2 * ball.radius;
+			double distance = (ball.vy > 0) ? line - ball.posY : ball.posY + line;
+			if (distance < 0) distance = 0;
+			double x = ball.posX + ball.vx * distance / fabs(ball.vy);
+
+			//Fold the straight path into the space between the walls
+			double left = ball.radius;
+			double span = screen_width - 10 - ball.radius - left;
+			double offset = fmod(x - left, 2 * span);
+			if (offset < 0) offset += 2 * span;
+			if (offset > span) offset = 2 * span - offset;
+			return static_cast<int>(left + offset);
+		}
+
+		//Chooses direction of the racket for the current tick.
+		void update()
+		{
+			//New aiming error for every fall of the ball
+			bool falling = ball.vy > 0;
+			if (falling && !wasFalling)
+			{
+				int maxError = static_cast<int>((1 - skill) * racket.width);
+				aimError = (maxError > 0) ? static_cast<int>(rng() % (2 * maxError + 1)) - maxError : 0;
+			}
+			wasFalling = falling;
+
+			//Like pressing the up arrow: a ball flying straight up and down would never reach some blocks
+			gamestate.speedChangeX = fabs(ball.vx) < 3;
+
+			int target = predictLandingX() + aimError;
+			int center = racket.pos + racket.width / 2;
+			if (center < target - racket.speed) racket.setDir('r');
+			else if (center > target + racket.speed) racket.setDir('l');
+			else racket.setDir('n');
+		}
+
+	private:
+		//Generator of aiming errors, seeded for repeatable runs.
+		mt19937 rng{ 1 };
+		//Distance from the predicted landing point the racket center is aimed at.
+		int aimError = 0;
+		//Defines whether the ball was falling in the previous tick.
+		bool wasFalling = false;
+	};
+
+	//Autopilot playing instead of the player.
+	Autopilot autopilot;
+
+	//Long running self-playing test reporting frame times and memory growth.
+	class SoakTest
+	{
+	public:
+		//Defines whether the soak test is running.
+		bool enabled = false;
+		//Minutes after which the test ends, 0 means never.
+		double durationMinutes = 0;
+		//Seconds between reports.
+		double reportInterval = 10;
+
+		//Starts measuring.
+		void begin()
+		{
+			start = SDL_GetPerformanceCounter();
+			lastReport = start;
+			heapAtStart = getHeapBytes();
+			frameTimes.reserve(4096);
+		}
+
+		//Records duration of one frame in ms.
+		void addFrame(double ms)
+		{
+			frameTimes.push_back(ms);
+		}
+
+		//Unpauses the game after it stays paused for about a second (level text, lost game).
+		void resumeIfPaused()
+		{
+			if (!gamestate.pause)
+			{
+				pausedLoops = 0;
+				return;
+			}
+			if (++pausedLoops >= 60)
+			{
+				gamestate.pause = false;
+				gamestate.message = Message::None;
+				pausedLoops = 0;
+			}
+		}
+
+		//Prints report if its interval has passed. Returns false when the test should end.
+		bool update(int level, int points)
+		{
+			if (secondsSince(lastReport) >= reportInterval)
+			{
+				report(level, points);
+				lastReport = SDL_GetPerformanceCounter();
+			}
+			return durationMinutes <= 0 || secondsSince(start) < durationMinutes * 60;
+		}
+
+		//Prints frame time statistics since the last report and memory growth since the start.
+		void report(int level, int points)
+		{
+			double avg = 0;
+			double p50 = 0;
+			double p99 = 0;
+			double worst = 0;
+			if (!frameTimes.empty())
+			{
+				sort(frameTimes.begin(), frameTimes.end());
+				for (double ms : frameTimes) avg += ms;
+				avg /= frameTimes.size();
+				p50 = frameTimes[frameTimes.size() / 2];
+				p99 = frameTimes[frameTimes.size() * 99 / 100];
+				worst = frameTimes.back();
+			}
+			printf("soak %8.0f s: frames %6zu avg %6.2f p50 %6.2f p99 %6.2f max %6.2f ms | heap %+lld KB (peak %lld KB) textures %lld KB | level %d points %d\n",
+				secondsSince(start), frameTimes.size(), avg, p50, p99, worst,
+				(getHeapBytes() - heapAtStart) / 1024,
+				(getMemoryPeak(MemoryCategory::CppHeap) + getMemoryPeak(MemoryCategory::SdlHeap)) / 1024,
+				getTextureBytes() / 1024, level, points);
+			frameTimes.clear();
+		}
+
+	private:
+		Uint64 start = 0;
+		Uint64 lastReport = 0;
+		long long heapAtStart = 0;
+		int pausedLoops = 0;
+		vector<double> frameTimes;
+	};
+
+	//Soak test run instead of normal play.
+	SoakTest soak;
+
+	//Draws blocks and racket on cleared canvas without advancing the game.
+	void drawBoard()
+	{
+		beginScene();
+		renderBlocks();
+		racket.render();
+		endScene();
+	}
+
+	/**
+	Checks number of heap allocations made by drawFrame(). In debug builds a frame allocating after the warm-up stops the game,
+	so a change bringing allocations back to the frame fails the first --workload run. Loading a level restarts the warm-up.
+	**/
+	void checkFrameAllocations(unsigned int allocations)
+	{
+#ifndef NDEBUG
+		if (allocations > 0 && framesSinceLoad > allocationWarmupFrames)
+		{
+			printf("Frame of tick %u made %u heap allocations after warm-up, the first of %zu bytes!\n", gamestate.ticks, allocations, getFirstGuardedAllocation());
+			fflush(stdout);
+			abort();
+		}
+#endif
+		framesSinceLoad++;
+	}
+
 	//Renders the frame
 	void drawFrame()
 	{
-		setDrawColor(0, 0, 0);
-		SDL_RenderClear(gameRend);
+		beginAllocationGuard();
+		beginScene();
+		setTelemetryTick(++gamestate.ticks);
+		scrollLevel();
 		checkBlocksHit();
+		renderBlocks();
 
-		if (!renderBlocks())
+		bool cleared = levelCleared();
+		if (!cleared)
 		{
-			if (gamestate.hudVisible) renderHud();
-
-
 			ball.move();
 			ball.render();
 			racket.move();
 			racket.render();
+			if (recordHistory) history.capture();
+		}
+		endScene();
+
+		//Text is drawn over the scene at the resolution of the window
+		if (cleared) advanceLevel();
+		else if (gamestate.hudVisible) renderHud();
+		SDL_RenderPresent(gameRend);
+		checkFrameAllocations(endAllocationGuard());
+	}
+
+	//Loads the next level, or shows the winning text after the last one. Returns false if the game is won.
+	bool advanceLevel()
+	{
+		gamestate.pause = true;
+		if (gamestate.currentLevel < 4)
+		{
+
+			gamestate.currentLevel++;
+			loadLevel(gamestate.currentLevel);
+			levelBeginText(gamestate.currentLevel);
+			return true;
 		}
+		levelEndText(true);
+		//Soak test plays all levels in a loop
+		if (soak.enabled)
+		{
+			gamestate.currentLevel = 1;
+			loadLevel(1);
+			gamestate.points = 0;
+		}
+		return false;
+	}
+
+	//Returns whether all blocks of the ongoing level are destroyed.
+	bool levelCleared()
+	{
+		//Chunks below the resident ones are evicted only when cleared, and the top chunk is the last one to come
+		if (isStreamed()) return slotOf(0) >= 0 && lowestBlockRow() < 0;
+		for (const Block& block : gameBlocks)
+		{
+			if (block.resistanceNow != 0) return false;
+		}
+		return true;
+	}
+
+	//Advances the game by one tick without rendering, like drawFrame(). Returns false if the game is won.
+	bool stepSimulation()
+	{
+		setTelemetryTick(++gamestate.ticks);
+		scrollLevel();
+		checkBlocksHit();
+		if (levelCleared()) return advanceLevel();
+		ball.move();
+		racket.move();
+		if (recordHistory) history.capture();
+		return true;
+	}
+
+	//Integer division rounding towards negative infinity.
+	long long floorDiv(long long a, long long b)
+	{
+		long long q = a / b;
+		if ((a % b != 0) && ((a < 0) != (b < 0))) q--;
+		return q;
+	}
+
+	//Integer division rounding towards positive infinity.
+	long long ceilDiv(long long a, long long b)
+	{
+		return -floorDiv(-a, b);
+	}
 
+	//Value meaning no limit in tick counts below.
+	const long long noEvent = 1LL << 62;
+
+	/**
+	Computes range of ticks i >= 0 in which start + i * velocity stays within [low, high].
+	Returns false if there is no such tick.
+	**/
+	bool ticksWithin(long long start, long long velocity, long long low, long long high, long long& first, long long& last)
+	{
+		if (velocity == 0)
+		{
+			if (start < low || start > high) return false;
+			first = 0;
+			last = noEvent;
+		}
+		else if (velocity > 0)
+		{
+			first = ceilDiv(low - start, velocity);
+			last = floorDiv(high - start, velocity);
+		}
 		else
 		{
-			gamestate.pause = true;
-			if (gamestate.currentLevel < 4)
-			{
+			first = ceilDiv(start - high, -velocity);
+			last = floorDiv(start - low, -velocity);
+		}
+		if (first < 0) first = 0;
+		return first <= last;
+	}
 
-				gamestate.currentLevel++;
-				loadLevel(gamestate.currentLevel);
-				levelBeginText(gamestate.currentLevel);
-			}
-			else
+	/**
+	Returns how many of the following ticks (at most limit) are free flight: the ball stays inside the walls,
+	above the racket line and below the top edge and touches no block, so every such tick only moves it by its velocity.
+	**/
+	long long ticksUntilEvent(long long limit)
+	{
+		if (!ball.isMoving) return 0;
+		long long x = ball.posX;
+		long long y = ball.posY;
+		long long vx = static_cast<long long>(ball.vx);
+		long long vy = static_cast<long long>(ball.vy);
+		long long r = ball.radius;
+		//Velocities change by whole numbers only; the analytic path relies on it.
+		if (vx != ball.vx || vy != ball.vy) return 0;
+		//Scrolling moves the blocks every tick
+		if (isStreamed() && scrollTarget() != scrollY) return 0;
+
+		long long first, last;
+		long long freeTicks = limit;
+		//Walls checked at the beginning of Ball::move()
+		if (!ticksWithin(x, vx, r, screen_width - 10 - r, first, last) || first > 0) return 0;
+		freeTicks = min(freeTicks, last + 1);
+		//Top edge and racket line
+		if (!ticksWithin(y, vy, 0, screen_height - 15 - racket.height - 2 * r, first, last) || first > 0) return 0;
+		freeTicks = min(freeTicks, last + 1);
+
+		//First tick on which the ball would overlap any live block in checkBlocksHit()
+		for (const BlockRange& range : visibleBlocks)
+		{
+			for (int i = range.begin; i < range.end && freeTicks > 0; i++)
 			{
-				levelEndText(true);
+				const Block& block = gameBlocks[i];
+				if (block.resistanceNow == 0) continue;
+				long long top = block.posY - scrollY;
+				long long xFirst, xLast, yFirst, yLast;
+				if (!ticksWithin(x, vx, block.posX - r + 1, block.posX + block.width + r - 1, xFirst, xLast)) continue;
+				if (!ticksWithin(y, vy, top - r, top + block.height + r, yFirst, yLast)) continue;
+				long long hit = max(xFirst, yFirst);
+				if (hit <= min(xLast, yLast)) freeTicks = min(freeTicks, hit);
 			}
 		}
-		SDL_RenderPresent(gameRend);
+		return freeTicks;
 	}
 
-	//Runs the game
-	bool run()
+	//Applies given number of free flight ticks at once, leaving the same state as stepping them one by one.
+	void skipFreeTicks(long long count)
 	{
-		if (!init())
+		ball.posX += static_cast<int>(count * static_cast<long long>(ball.vx));
+		ball.posY += static_cast<int>(count * static_cast<long long>(ball.vy));
+		if (ball.justBounced)
 		{
-			printf("Failed to initialize!\n");
-			return false;
+			if (ball.justBounced + count >= ball.bounceBlock) ball.justBounced = 0;
+			else ball.justBounced += static_cast<int>(count);
 		}
-		if (!loadMedia())
+		for (long long i = 0; i < count; i++) racket.move();
+		gamestate.ticks += static_cast<unsigned int>(count);
+		setTelemetryTick(gamestate.ticks);
+		//The span is recorded as records of at most INT16_MAX ticks each, so per tick statistics stay the same as stepping
+		for (long long left = count; left > 0; left -= INT16_MAX)
 		{
-			printf("Failed to load media!\n");
-			return false;
+			int ticks = static_cast<int>(min<long long>(left, INT16_MAX));
+			emitTelemetry(TelemetryEvent::BallMove, gamestate.currentLevel, ball.vx, ball.vy, ticks, gamestate.points);
+		}
+		if (recordHistory) history.capture();
+	}
+
+	/**
+	Advances the game by given number of ticks without rendering. With fastForward enabled, ticks in which the ball
+	only flies are skipped analytically and only ticks with a possible bounce or hit are simulated.
+	Returns number of simulated ticks, which is lower if the game was won earlier.
+	**/
+	unsigned long long simulate(unsigned long long ticks, bool fastForward)
+	{
+		unsigned long long done = 0;
+		//Skipped ticks assume the racket keeps its direction, which the autopilot may change on any tick
+		if (autopilot.enabled) fastForward = false;
+		while (done < ticks)
+		{
+			if (autopilot.enabled) autopilot.update();
+			long long freeTicks = fastForward ? ticksUntilEvent(static_cast<long long>(ticks - done)) : 0;
+			if (freeTicks > 0)
+			{
+				skipFreeTicks(freeTicks);
+				done += freeTicks;
+				continue;
+			}
+			done++;
+			if (!stepSimulation()) break;
 		}
+		return done;
+	}
+
+	//Plays given number of ticks without a window and prints the final state.
+	bool runHeadless(unsigned long long ticks, bool fastForward)
+	{
 		if (!loadLevelData())
 		{
 			printf("Failed to load levels!\n");
@@ -907,55 +2108,1140 @@ namespace ballgame
 			printf("Failed to load level.\n");
 			return false;
 		}
-		levelBeginText(gamestate.currentLevel);
-		//Flag defining whether the program is running or user quitted.
-		bool quit = false;
-		//Flag defining whether the game is paused or not.
-		bool pause = false;
-		//Event handling user's input.
-		SDL_Event e;
 		ball.isMoving = true;
-		while (!quit)
+		Uint64 start = SDL_GetPerformanceCounter();
+		unsigned long long done = simulate(ticks, fastForward);
+		double elapsed = secondsSince(start);
+		printf("ticks: %llu level: %d points: %d health: %d ball: %d %d %d %d racket: %d\n", done, gamestate.currentLevel,
+			gamestate.points, gamestate.health, ball.posX, ball.posY, static_cast<int>(ball.vx), static_cast<int>(ball.vy), racket.pos);
+		printf("simulated in %.3f s\n", elapsed);
+		return true;
+	}
+
+	//Generates board of given settings into the spare level slot and prints its loading, collision and rendering cost.
+	bool benchmarkBoard(const string& label, const LevelGeneratorSettings& settings, const string& filename, int id)
+	{
+		if (!generateLevelFile(settings, filename))
 		{
-			while (SDL_PollEvent(&e) != 0)
-			{
-				if (e.type == SDL_QUIT)
-				{
-					quit = true;
-				}
-				if (e.type == SDL_KEYDOWN)
-				{
-					switch (e.key.keysym.sym)
-					{
-					case SDLK_p:
-						gamestate.pause ^= true;
-						break;
-					case SDLK_h:
-						gamestate.hudVisible ^= true;
-						break;
-					case SDLK_LEFT:
-						racket.setDir('l');
-						break;
-					case SDLK_RIGHT:
-						racket.setDir('r');
-						break;
-					case SDLK_UP:
-						gamestate.speedChangeX ^= true;
-						break;
-					}
-				}
-			}
-			if (!gamestate.pause) drawFrame();
-			SDL_Delay(15);
+			printf("Failed to write %s.\n", filename.c_str());
+			return false;
 		}
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		loadLevelPatternFile(filename, id);
+		defineBlocks(id + 1);
+		double loadTime = secondsSince(start);
+		size_t memory = levels[id].patternData.capacity() * sizeof(int) + gameBlocks.capacity() * sizeof(Block);
+		memory += levelStream.getChunkCount() * sizeof(streamoff);
+
+		//Ball above the board never hits, so every block on screen is checked
+		ball.posX = int(screen_width / 2);
+		ball.posY = -1000;
+		int ticks = 0;
+		start = SDL_GetPerformanceCounter();
+		while (ticks < 10 || secondsSince(start) < 0.25)
+		{
+			checkBlocksHit();
+			ticks++;
+		}
+		double tickTime = secondsSince(start) / ticks;
+
+		int frames = 0;
+		start = SDL_GetPerformanceCounter();
+		while (frames < 3 || secondsSince(start) < 0.5)
+		{
+			setDrawColor(0, 0, 0);
+			SDL_RenderClear(gameRend);
+			renderBlocks();
+			SDL_RenderPresent(gameRend);
+			frames++;
+		}
+		double frameTime = secondsSince(start) / frames;
+
+		printf("%10s %12.2f %12zu %12.2f %12.2f\n", label.c_str(), loadTime * 1000, memory / 1024, tickTime * 1000000, frameTime * 1000);
+		return true;
+	}
+
+	/**
+	Measures level loading, collision and rendering cost on generated boards of growing size.
+	The largest board is measured once more as a streamed level, whose cost does not depend on its length.
+	**/
+	bool runBenchmark()
+	{
+		windowFlags = SDL_WINDOW_HIDDEN;
+		if (!init())
+		{
+			printf("Failed to initialize!\n");
+			close();
+			return false;
+		}
+		const int sizes[] = { 50, 500, 5000, 50000, 500000, 1000000 };
+		const string filename = "benchmark_level.txt";
+		//Spare slot of the levels array, not used by the game.
+		const int id = 4;
+
+		printf("%10s %12s %12s %12s %12s\n", "blocks", "load ms", "memory KB", "tick us", "frame ms");
+		LevelGeneratorSettings settings;
+		settings.columns = 10;
+		bool generated = true;
+		for (int blocks : sizes)
+		{
+			settings.rows = blocks / settings.columns;
+			settings.seed = blocks;
+			generated = benchmarkBoard(to_string(blocks), settings, filename, id);
+			if (!generated) break;
+		}
+		if (generated)
+		{
+			settings.chunkRows = 16;
+			benchmarkBoard("streamed", settings, filename, id);
+		}
+		remove(filename.c_str());
+		levels[id] = Level();
+		levelStream.close();
+		chunkSlots.clear();
+		gameBlocks.clear();
+		visibleBlocks.clear();
 		close();
 		return true;
 	}
 
-};
+	//Player's action, passed from the thread handling events to the simulation.
+	enum class InputCommand : Uint8
+	{
+		None,
+		Pause,
+		Hud,
+		Left,
+		Right,
+		Focus,
+		Rewind,
+		Suspend
+	};
 
-int main()
-{
-	ballgame::run();
-	return 0;
+	//Returns action bound to given key.
+	InputCommand commandForKey(SDL_Keycode key)
+	{
+		switch (key)
+		{
+		case SDLK_p:
+			return InputCommand::Pause;
+		case SDLK_h:
+			return InputCommand::Hud;
+		case SDLK_LEFT:
+			return InputCommand::Left;
+		case SDLK_RIGHT:
+			return InputCommand::Right;
+		case SDLK_UP:
+			return InputCommand::Focus;
+		case SDLK_r:
+			return InputCommand::Rewind;
+		default:
+			return InputCommand::None;
+		}
+	}
+
+	//Applies player's action to the game.
+	void applyInput(InputCommand command)
+	{
+		switch (command)
+		{
+		case InputCommand::Pause:
+			gamestate.pause ^= true;
+			if (!gamestate.pause) gamestate.message = Message::None;
+			break;
+		case InputCommand::Hud:
+			gamestate.hudVisible ^= true;
+			break;
+		case InputCommand::Left:
+			racket.setDir('l');
+			break;
+		case InputCommand::Right:
+			racket.setDir('r');
+			break;
+		case InputCommand::Focus:
+			gamestate.speedChangeX ^= true;
+			break;
+		case InputCommand::Rewind:
+			if (recordHistory) history.restore(min(rewindTicks, history.size() - 1));
+			break;
+		case InputCommand::Suspend:
+			gamestate.pause = true;
+			break;
+		default:
+			break;
+		}
+	}
+
+	//Key pressed by the workload on given tick of every level.
+	struct ScriptedInput
+	{
+		int tick;
+		InputCommand command;
+	};
+
+	//Session played on every level of the workload, going through focus changes, the HUD, pausing and rewinding.
+	const ScriptedInput workloadScript[] = {
+		{ 200, InputCommand::Focus },
+		{ 400, InputCommand::Hud },
+		{ 700, InputCommand::Rewind },
+		{ 900, InputCommand::Focus },
+		{ 1100, InputCommand::Pause },
+		{ 1101, InputCommand::Pause },
+		{ 1300, InputCommand::Hud },
+		{ 1600, InputCommand::Rewind }
+	};
+
+	//Costs measured by the workload on one level.
+	struct WorkloadResult
+	{
+		int level = 0;
+		double frameAvg = 0;
+		double frameP99 = 0;
+		double tickUs = 0;
+	};
+
+	//Reads report written by runWorkload(). Returns false if the file cannot be read.
+	bool readWorkloadReport(const string& path, vector<WorkloadResult>& results)
+	{
+		FILE* file = fopen(path.c_str(), "r");
+		if (file == NULL) return false;
+		//Skip the header line
+		char header[128];
+		if (fgets(header, sizeof(header), file) == NULL)
+		{
+			fclose(file);
+			return false;
+		}
+		WorkloadResult result;
+		while (fscanf(file, "%d %lf %lf %lf", &result.level, &result.frameAvg, &result.frameP99, &result.tickUs) == 4)
+		{
+			results.push_back(result);
+		}
+		fclose(file);
+		return true;
+	}
+
+	//Returns change from base to now in percent.
+	double percentChange(double base, double now)
+	{
+		return (base > 0) ? (now - base) / base * 100 : 0;
+	}
+
+	/**
+	Plays every level with the autopilot and the scripted session in a hidden window and measures frame time of drawFrame()
+	and tick time of headless stepSimulation(). It is the training run of profile-guided builds, see README.
+	The results are written to reportPath if given; with baselinePath the changes against an earlier report are printed.
+	**/
+	bool runWorkload(const string& reportPath, const string& baselinePath)
+	{
+		const int frameTicks = 2000;
+		const int headlessTicks = 50000;
+		windowFlags = SDL_WINDOW_HIDDEN;
+		if (!init())
+		{
+			printf("Failed to initialize!\n");
+			close();
+			return false;
+		}
+		if (!loadLevelData())
+		{
+			printf("Failed to load levels!\n");
+			close();
+			return false;
+		}
+		if (!loadMedia(decodeImages(), openFonts()))
+		{
+			printf("Failed to load media!\n");
+			close();
+			return false;
+		}
+		autopilot.enabled = true;
+
+		vector<WorkloadResult> results;
+		vector<double> frameTimes;
+		frameTimes.reserve(frameTicks);
+		for (int level = 1; level <= 4; level++)
+		{
+			WorkloadResult result;
+			result.level = level;
+
+			gamestate.currentLevel = level;
+			gamestate.points = 0;
+			loadLevel(level);
+			gamestate.hudVisible = true;
+			gamestate.pause = false;
+			gamestate.message = Message::None;
+			ball.isMoving = true;
+			frameTimes.clear();
+			size_t script = 0;
+			for (int tick = 0; tick < frameTicks; tick++)
+			{
+				while (script < sizeof(workloadScript) / sizeof(workloadScript[0]) && workloadScript[script].tick == tick)
+				{
+					applyInput(workloadScript[script].command);
+					script++;
+				}
+				//Level text and lost game wait for a key press
+				if (gamestate.message != Message::None) applyInput(InputCommand::Pause);
+				if (gamestate.pause) continue;
+				autopilot.update();
+				Uint64 start = SDL_GetPerformanceCounter();
+				drawFrame();
+				frameTimes.push_back(secondsSince(start) * 1000);
+			}
+			if (!frameTimes.empty())
+			{
+				for (double ms : frameTimes) result.frameAvg += ms;
+				result.frameAvg /= frameTimes.size();
+				sort(frameTimes.begin(), frameTimes.end());
+				result.frameP99 = frameTimes[frameTimes.size() * 99 / 100];
+			}
+
+			gamestate.currentLevel = level;
+			loadLevel(level);
+			ball.isMoving = true;
+			Uint64 start = SDL_GetPerformanceCounter();
+			unsigned long long done = simulate(headlessTicks, false);
+			result.tickUs = secondsSince(start) * 1000000 / max(done, 1ULL);
+			results.push_back(result);
+		}
+		autopilot.enabled = false;
+		close();
+
+		vector<WorkloadResult> baseline;
+		if (!baselinePath.empty() && !readWorkloadReport(baselinePath, baseline))
+		{
+			printf("Unable to read baseline %s!\n", baselinePath.c_str());
+		}
+		printf("%6s %14s %14s %12s\n", "level", "frame avg ms", "frame p99 ms", "tick us");
+		for (const WorkloadResult& result : results)
+		{
+			printf("%6d %14.4f %14.4f %12.4f\n", result.level, result.frameAvg, result.frameP99, result.tickUs);
+			for (const WorkloadResult& base : baseline)
+			{
+				if (base.level != result.level) continue;
+				printf("%6s %+13.1f%% %+13.1f%% %+11.1f%%\n", "vs base", percentChange(base.frameAvg, result.frameAvg),
+					percentChange(base.frameP99, result.frameP99), percentChange(base.tickUs, result.tickUs));
+			}
+		}
+
+		if (!reportPath.empty())
+		{
+			FILE* file = fopen(reportPath.c_str(), "w");
+			if (file == NULL)
+			{
+				printf("Unable to create %s!\n", reportPath.c_str());
+				return false;
+			}
+			fprintf(file, "level frame_avg_ms frame_p99_ms tick_us\n");
+			for (const WorkloadResult& result : results)
+			{
+				fprintf(file, "%d %.6f %.6f %.6f\n", result.level, result.frameAvg, result.frameP99, result.tickUs);
+			}
+			fclose(file);
+		}
+		return true;
+	}
+
+	//World of a game kept out of the thread_local globals, while another thread plays it or between batch steps.
+	struct WorldState
+	{
+		GameState gamestate;
+		Ball ball;
+		Racket racket;
+		vector<Block> blocks;
+		vector<BlockRange> visibleBlocks;
+		int scrollY = 0;
+		vector<int> chunkSlots;
+		int slotBlocks = 0;
+	};
+
+	//Exchanges world of the calling thread with given one. Blocks are swapped without copying; rewind history stays with the thread.
+	void swapWorld(WorldState& world)
+	{
+		swap(gamestate, world.gamestate);
+		swap(ball, world.ball);
+		swap(racket, world.racket);
+		gameBlocks.swap(world.blocks);
+		visibleBlocks.swap(world.visibleBlocks);
+		swap(scrollY, world.scrollY);
+		chunkSlots.swap(world.chunkSlots);
+		swap(slotBlocks, world.slotBlocks);
+	}
+
+	//Block as drawn by the render thread.
+	struct BlockView
+	{
+		SDL_Rect rect;
+		int resistance;
+	};
+
+	//State of the game published by the simulation thread, holding everything needed to draw a frame.
+	struct FrameSnapshot
+	{
+		unsigned int ticks = 0;
+		int ballX = 0;
+		int ballY = 0;
+		SDL_Rect racketRect = { 0, 0, 0, 0 };
+		//Blocks not destroyed yet. Capacity is kept between frames, so it allocates only when the board grows.
+		vector<BlockView> blocks;
+		bool hudVisible = false;
+		HudValues hud;
+		bool pause = false;
+		Message message = Message::None;
+		int messagePoints = 0;
+	};
+
+	//Defines whether simulation runs on its own thread, see runThreaded().
+	bool threadedSimulation = false;
+	//Frames passed from the simulation thread to the render thread.
+	TripleBuffer<FrameSnapshot> frames;
+	//Actions passed from the event handling thread to the simulation thread.
+	SpscQueue<InputCommand, 64> inputQueue;
+	//Asks the simulation thread to finish.
+	atomic<bool> simulationStop{ false };
+	//Wakes the paused simulation thread when input arrives or the game quits.
+	condition_variable simulationWake;
+	mutex simulationWakeMutex;
+	//Set with simulationWakeMutex held when there is a reason to wake the simulation thread.
+	bool simulationWakePending = false;
+	//World handed from the main thread to the simulation thread and back when it finishes.
+	WorldState simulationWorld;
+
+	//Wakes the simulation thread if it sleeps while paused.
+	void wakeSimulation()
+	{
+		{
+			lock_guard<mutex> lock(simulationWakeMutex);
+			simulationWakePending = true;
+		}
+		simulationWake.notify_one();
+	}
+
+	//Copies state needed for drawing into given snapshot.
+	void captureFrame(FrameSnapshot& frame)
+	{
+		frame.ticks = gamestate.ticks;
+		frame.ballX = ball.posX;
+		frame.ballY = ball.posY;
+		frame.racketRect = { racket.pos, screen_height - racket.height - 10, racket.width, racket.height };
+		frame.blocks.clear();
+		for (const BlockRange& range : visibleBlocks)
+		{
+			for (int i = range.begin; i < range.end; i++)
+			{
+				const Block& block = gameBlocks[i];
+				if (block.resistanceNow == 0) continue;
+				frame.blocks.push_back({ { block.posX, block.posY - scrollY, block.width, block.height }, block.resistanceNow });
+			}
+		}
+		frame.hudVisible = gamestate.hudVisible;
+		frame.hud = currentHud();
+		frame.pause = gamestate.pause;
+		frame.message = gamestate.message;
+		frame.messagePoints = gamestate.messagePoints;
+	}
+
+	//Draws frame from a published snapshot. Runs on the render thread and touches no simulation state.
+	void drawSnapshot(const FrameSnapshot& frame)
+	{
+		beginScene();
+		for (const BlockView& block : frame.blocks)
+		{
+			color c = resistanceColor(block.resistance);
+			setDrawColor(c.red, c.green, c.blue);
+			SDL_RenderFillRect(gameRend, &block.rect);
+		}
+		if (frame.message == Message::None) ballTex->render(frame.ballX, frame.ballY);
+		setDrawColor(racket.mColor.red, racket.mColor.green, racket.mColor.blue);
+		SDL_RenderFillRect(gameRend, &frame.racketRect);
+		endScene();
+
+		if (frame.hudVisible) renderHud(frame.hud);
+
+		if (frame.message == Message::LevelBegin) drawLevelBeginText(frame.hud.level);
+		else if (frame.message == Message::Won) drawLevelEndText(true, frame.messagePoints);
+		else if (frame.message == Message::Lost) drawLevelEndText(false, frame.messagePoints);
+		SDL_RenderPresent(gameRend);
+	}
+
+	//Runs the game rules every 15 ms and publishes a snapshot after every tick.
+	void simulationLoop()
+	{
+		simulationThread = true;
+		swapWorld(simulationWorld);
+		const Uint64 frequency = SDL_GetPerformanceFrequency();
+		const Uint64 tickLength = frequency * 15 / 1000;
+		Uint64 nextTick = SDL_GetPerformanceCounter();
+		InputCommand command;
+		while (!simulationStop.load(memory_order_relaxed))
+		{
+			while (inputQueue.pop(command)) applyInput(command);
+			if (autopilot.enabled) autopilot.update();
+			if (soak.enabled) soak.resumeIfPaused();
+			if (!gamestate.pause) stepSimulation();
+			captureFrame(frames.writeBuffer());
+			frames.publish();
+			eventWaiter.wake();
+
+			//Paused game changes only on input, so sleep until it comes
+			if (gamestate.pause && !soak.enabled)
+			{
+				unique_lock<mutex> lock(simulationWakeMutex);
+				simulationWake.wait_for(lock, chrono::milliseconds(idleScheduler.idleTimeout), []() { return simulationWakePending; });
+				simulationWakePending = false;
+				idleScheduler.countWakeup();
+				nextTick = SDL_GetPerformanceCounter();
+				continue;
+			}
+
+			nextTick += tickLength;
+			Uint64 now = SDL_GetPerformanceCounter();
+			if (nextTick > now)
+			{
+				SDL_Delay(static_cast<Uint32>((nextTick - now) * 1000 / frequency));
+				idleScheduler.countWakeup();
+			}
+			//Too far behind to catch up, continue from now
+			else if (now - nextTick > 4 * tickLength) nextTick = now;
+		}
+		swapWorld(simulationWorld);
+	}
+
+	/**
+	Plays the game with the simulation on a separate thread. This thread handles events, forwarding input through
+	a wait-free queue, and draws the newest snapshot from the triple buffer, so a slow present never delays physics.
+	**/
+	void runThreaded()
+	{
+		captureFrame(frames.writeBuffer());
+		frames.publish();
+		//Read before the world is handed to the simulation thread
+		int level = gamestate.currentLevel;
+		int points = gamestate.points;
+		simulationStop = false;
+		swapWorld(simulationWorld);
+		thread simulation(simulationLoop);
+
+		bool quit = false;
+		SDL_Event e;
+		//Handles single event on the render thread
+		auto handleEvent = [&quit](const SDL_Event& e)
+		{
+			InputCommand command = InputCommand::None;
+			if (e.type == SDL_QUIT)
+			{
+				quit = true;
+			}
+			if (e.type == SDL_KEYDOWN)
+			{
+				command = commandForKey(e.key.keysym.sym);
+			}
+			if (idleScheduler.isSuspendEvent(e) && !autopilot.enabled) command = InputCommand::Suspend;
+			if (command != InputCommand::None && inputQueue.push(command)) wakeSimulation();
+		};
+		while (!quit)
+		{
+			//Sleeps until the simulation publishes a frame or input comes
+			if (eventWaiter.wait(e, idleScheduler.idleTimeout)) handleEvent(e);
+			while (SDL_PollEvent(&e) != 0) handleEvent(e);
+			if (frames.update())
+			{
+				const FrameSnapshot& frame = frames.readBuffer();
+				Uint64 frameStart = SDL_GetPerformanceCounter();
+				drawSnapshot(frame);
+				double frameMs = secondsSince(frameStart) * 1000;
+				if (soak.enabled) soak.addFrame(frameMs);
+				adaptRenderScale(frameMs);
+				level = frame.hud.level;
+				points = frame.hud.points;
+			}
+			if (soak.enabled && !soak.update(level, points)) quit = true;
+		}
+		simulationStop = true;
+		wakeSimulation();
+		simulation.join();
+		swapWorld(simulationWorld);
+		if (soak.enabled) soak.report(level, points);
+	}
+
+	//Returns command of the player taking given batch action.
+	InputCommand commandForAction(BatchAction action)
+	{
+		switch (action)
+		{
+		case BatchAction::Left:
+			return InputCommand::Left;
+		case BatchAction::Right:
+			return InputCommand::Right;
+		case BatchAction::Focus:
+			return InputCommand::Focus;
+		default:
+			return InputCommand::None;
+		}
+	}
+
+	/**
+	Many independent games stepped in lockstep for automated players, all by the rules of stepSimulation().
+	Every game is a WorldState swapped into the globals of the worker thread stepping it; games are split into contiguous
+	shards, one per worker. Actions are read from and results written to one buffer laid out by BatchLayout.h, which may
+	be given by the caller, for example mapped shared memory read by another process.
+	Streamed levels are not supported, their loader is shared by all threads.
+	**/
+	class BatchEnvironment
+	{
+	public:
+		BatchEnvironment()
+		{
+		}
+
+		~BatchEnvironment()
+		{
+			stopWorkers();
+		}
+
+		BatchEnvironment(const BatchEnvironment&) = delete;
+		BatchEnvironment& operator=(const BatchEnvironment&) = delete;
+
+		/**
+		Creates envCount games starting at given level, stepped by threadCount worker threads.
+		Without memory the buffer is allocated, otherwise memory must hold getBufferSize() bytes for these games. Returns false on failure.
+		**/
+		bool create(int envCount, int level, int threadCount, void* memory)
+		{
+			stopWorkers();
+			if (envCount <= 0 || level < 1 || level > 4)
+			{
+				printf("Invalid batch of %d games at level %d.\n", envCount, level);
+				return false;
+			}
+			if (!loadLevelData())
+			{
+				printf("Failed to load levels!\n");
+				return false;
+			}
+			//Levels are shared by all workers, so every one is loaded before they start
+			int maxBlocks = 0;
+			for (int id = 1; id <= 4; id++)
+			{
+				loadLevelInfo(id);
+				if (!loadLevelPattern(id))
+				{
+					printf("Failed to load %d level pattern.\n", id);
+					return false;
+				}
+				if (levels[id - 1].chunkRows > 0)
+				{
+					printf("Level %d is streamed, batch games need levels read at once.\n", id);
+					return false;
+				}
+				maxBlocks = max(maxBlocks, levels[id - 1].patternSize);
+			}
+
+			BatchHeader layout;
+			bufferSize = layoutBatchBuffer(layout, envCount, ObservationBlocks + maxBlocks);
+			if (memory == NULL)
+			{
+				ownedBuffer.assign(bufferSize + batchAlignment, 0);
+				uintptr_t address = reinterpret_cast<uintptr_t>(ownedBuffer.data());
+				memory = ownedBuffer.data() + (alignBatchOffset(address) - address);
+			}
+			header = new (memory) BatchHeader();
+			layoutBatchBuffer(*header, envCount, ObservationBlocks + maxBlocks);
+			actions = batchArray<BatchAction>(header, header->actionsOffset);
+			observations = batchArray<int32_t>(header, header->observationsOffset);
+			rewards = batchArray<float>(header, header->rewardsOffset);
+			done = batchArray<uint8_t>(header, header->doneOffset);
+			fill(actions, actions + envCount, BatchAction::None);
+			fill(rewards, rewards + envCount, 0.0f);
+			fill(done, done + envCount, 0);
+
+			startLevel = level;
+			worlds = vector<WorldState>(envCount);
+			shardCount = max(1, min(threadCount, envCount));
+			stopping = false;
+			for (int shard = 0; shard < shardCount; shard++)
+			{
+				workers.emplace_back(&BatchEnvironment::workerLoop, this, shard);
+			}
+			reset();
+			return true;
+		}
+
+		//Starts every game again and writes their first observations.
+		void reset()
+		{
+			runTask(Task::Reset);
+			header->steps.store(0, memory_order_release);
+		}
+
+		//Applies actions of the buffer to every game, advances them by one tick and writes observations, rewards and done flags.
+		void step()
+		{
+			runTask(Task::Step);
+			//Only this thread writes the counter; release publishes the results written by the workers
+			header->steps.store(header->steps.load(memory_order_relaxed) + 1, memory_order_release);
+		}
+
+		BatchHeader* getHeader()
+		{
+			return header;
+		}
+
+		size_t getBufferSize()
+		{
+			return bufferSize;
+		}
+
+	private:
+		enum class Task
+		{
+			Reset,
+			Step
+		};
+
+		//Returns first game of given shard; shardCount gives the end of the last one.
+		int shardBegin(int shard)
+		{
+			return static_cast<int>(static_cast<long long>(worlds.size()) * shard / shardCount);
+		}
+
+		//Runs task on every shard and waits until all workers finish it.
+		void runTask(Task task)
+		{
+			{
+				lock_guard<mutex> lock(workMutex);
+				currentTask = task;
+				generation++;
+				pendingShards = shardCount;
+			}
+			workStart.notify_all();
+			unique_lock<mutex> lock(workMutex);
+			workDone.wait(lock, [this]() { return pendingShards == 0; });
+		}
+
+		void stopWorkers()
+		{
+			{
+				lock_guard<mutex> lock(workMutex);
+				stopping = true;
+			}
+			workStart.notify_all();
+			for (thread& worker : workers) worker.join();
+			workers.clear();
+			//Workers started by the next create() have seen no task yet
+			generation = 0;
+			pendingShards = 0;
+		}
+
+		void workerLoop(int shard)
+		{
+			simulationThread = true;
+			recordHistory = false;
+			unsigned long long seen = 0;
+			while (true)
+			{
+				Task task;
+				{
+					unique_lock<mutex> lock(workMutex);
+					workStart.wait(lock, [this, seen]() { return generation != seen || stopping; });
+					if (stopping) return;
+					seen = generation;
+					task = currentTask;
+				}
+				for (int env = shardBegin(shard); env < shardBegin(shard + 1); env++)
+				{
+					WorldState& world = worlds[env];
+					swapWorld(world);
+					if (task == Task::Step) stepGame(env);
+					else restartGame();
+					observe(env);
+					swapWorld(world);
+				}
+				bool last;
+				{
+					lock_guard<mutex> lock(workMutex);
+					last = --pendingShards == 0;
+				}
+				if (last) workDone.notify_one();
+			}
+		}
+
+		//Starts a new game in the world of the calling thread.
+		void restartGame()
+		{
+			gamestate = GameState();
+			ball = Ball();
+			racket = Racket();
+			gamestate.currentLevel = startLevel;
+			loadLevel(startLevel);
+			ball.isMoving = true;
+		}
+
+		//Steps the game in the world of the calling thread, restarting it when it is won or lost.
+		void stepGame(int env)
+		{
+			applyInput(commandForAction(actions[env]));
+			int points = gamestate.points;
+			gamestate.message = Message::None;
+			bool playing = stepSimulation();
+			bool lost = gamestate.message == Message::Lost;
+			//Losing the game resets points, so only the lost life is counted
+			rewards[env] = lost ? -10.0f : static_cast<float>(gamestate.points - points);
+			done[env] = (lost || !playing) ? 1 : 0;
+			if (done[env]) restartGame();
+		}
+
+		//Writes observation of the world of the calling thread.
+		void observe(int env)
+		{
+			int32_t* values = observations + static_cast<size_t>(env) * header->observationSize;
+			values[ObservationBallX] = ball.posX;
+			values[ObservationBallY] = ball.posY;
+			values[ObservationBallVx] = static_cast<int32_t>(ball.vx);
+			values[ObservationBallVy] = static_cast<int32_t>(ball.vy);
+			values[ObservationRacketPos] = racket.pos;
+			values[ObservationRacketWidth] = racket.width;
+			values[ObservationLevel] = gamestate.currentLevel;
+			values[ObservationHealth] = gamestate.health;
+			values[ObservationPoints] = gamestate.points;
+			values[ObservationFocusX] = gamestate.speedChangeX ? 1 : 0;
+			const vector<Block>& blocks = gameBlocks;
+			int32_t* resistances = values + ObservationBlocks;
+			for (size_t i = 0; i < blocks.size(); i++) resistances[i] = blocks[i].resistanceNow;
+			fill(resistances + blocks.size(), values + header->observationSize, 0);
+		}
+
+		vector<WorldState> worlds;
+		int startLevel = 1;
+
+		vector<char> ownedBuffer;
+		size_t bufferSize = 0;
+		BatchHeader* header = NULL;
+		BatchAction* actions = NULL;
+		int32_t* observations = NULL;
+		float* rewards = NULL;
+		uint8_t* done = NULL;
+
+		vector<thread> workers;
+		int shardCount = 0;
+		mutex workMutex;
+		//Signals a new task to the workers.
+		condition_variable workStart;
+		//Signals the last finished shard to runTask().
+		condition_variable workDone;
+		Task currentTask = Task::Reset;
+		//Number of tasks given to the workers.
+		unsigned long long generation = 0;
+		int pendingShards = 0;
+		bool stopping = false;
+	};
+
+	/**
+	Writes action of every game of the batch: the racket follows the ball.
+	With keyMix some steps press a key chosen by the step and the game instead, so games differ from each other.
+	**/
+	void writeBatchActions(BatchEnvironment& batch, unsigned long long step, bool keyMix)
+	{
+		BatchHeader* header = batch.getHeader();
+		BatchAction* actions = batchArray<BatchAction>(header, header->actionsOffset);
+		const int32_t* observations = batchArray<int32_t>(header, header->observationsOffset);
+		for (uint32_t env = 0; env < header->envCount; env++)
+		{
+			const int32_t* values = observations + static_cast<size_t>(env) * header->observationSize;
+			int center = values[ObservationRacketPos] + values[ObservationRacketWidth] / 2;
+			actions[env] = values[ObservationBallX] < center ? BatchAction::Left : BatchAction::Right;
+			//Every fourth game only presses keys, so it loses and restarts
+			if (keyMix && (env % 4 == 0 || (step + env) % (env % 7 + 3) == 0)) actions[env] = static_cast<BatchAction>((step / 8 * 31 + env) % 4);
+		}
+	}
+
+	//Steps a batch of games, every one with the racket following the ball, and prints their throughput.
+	bool runBatch(int envCount, unsigned long long steps, int threadCount)
+	{
+		BatchEnvironment batch;
+		if (!batch.create(envCount, gamestate.currentLevel, threadCount, NULL)) return false;
+		BatchHeader* header = batch.getHeader();
+		const float* rewards = batchArray<float>(header, header->rewardsOffset);
+		const uint8_t* done = batchArray<uint8_t>(header, header->doneOffset);
+
+		double reward = 0;
+		unsigned long long finished = 0;
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (unsigned long long step = 0; step < steps; step++)
+		{
+			writeBatchActions(batch, step, false);
+			batch.step();
+			for (int env = 0; env < envCount; env++)
+			{
+				reward += rewards[env];
+				finished += done[env];
+			}
+		}
+		double elapsed = secondsSince(start);
+		printf("games: %d threads: %d steps: %llu buffer: %zu bytes\n", envCount, threadCount, steps, batch.getBufferSize());
+		printf("stepped in %.3f s, %.0f game ticks/s\n", elapsed, envCount * static_cast<double>(steps) / elapsed);
+		printf("games finished: %llu mean reward: %.2f\n", finished, reward / envCount);
+		return true;
+	}
+
+	/**
+	Checks that a batch created again on the same object, with other sizes and threads, plays the same as a batch created once.
+	Games are independent and deterministic, so all results must be equal after every step. Returns false on a difference.
+	**/
+	bool runBatchTest()
+	{
+		const int games = 37;
+		const unsigned long long steps = 5000;
+		BatchEnvironment recreated;
+		BatchEnvironment reference;
+		//Leaves tasks counted by earlier workers before the last create()
+		for (int i = 1; i <= 4; i++)
+		{
+			if (!recreated.create(i * 3, i, i, NULL)) return false;
+			for (int j = 0; j < i * 5; j++) recreated.step();
+		}
+		if (!recreated.create(games, 1, 3, NULL) || !reference.create(games, 1, 2, NULL)) return false;
+
+		BatchHeader* a = recreated.getHeader();
+		BatchHeader* b = reference.getHeader();
+		//Results follow the actions in the buffer, and both buffers have the same layout
+		size_t resultsSize = recreated.getBufferSize() - a->observationsOffset;
+		unsigned long long finished = 0;
+		for (unsigned long long step = 0; step <= steps; step++)
+		{
+			if (memcmp(reinterpret_cast<char*>(a) + a->observationsOffset, reinterpret_cast<char*>(b) + b->observationsOffset, resultsSize) != 0)
+			{
+				printf("batch test failed: results differ after %llu steps\n", step);
+				return false;
+			}
+			const uint8_t* done = batchArray<uint8_t>(a, a->doneOffset);
+			for (int env = 0; env < games; env++) finished += done[env];
+			if (step == steps) break;
+			writeBatchActions(recreated, step, true);
+			writeBatchActions(reference, step, true);
+			recreated.step();
+			reference.step();
+		}
+		printf("batch test passed: %d games, %llu steps, %llu games finished\n", games, steps, finished);
+		return true;
+	}
+
+	//Runs the game
+	bool run()
+	{
+		startupTimeline.begin();
+		//Work not needing the renderer runs on worker threads while the window is created.
+		int firstLevel = gamestate.currentLevel;
+		future<bool> levelsLoaded = async(launch::async, [firstLevel]()
+		{
+			double start = startupTimeline.now();
+			bool success = loadLevelData() && loadLevelPattern(firstLevel);
+			startupTimeline.add("level parsing", start, startupTimeline.now());
+			return success;
+		});
+		//Libraries are initialized before workers decode media with them
+		if (!initLibraries())
+		{
+			printf("Failed to initialize!\n");
+			close();
+			return false;
+		}
+		future<SDL_Surface*> imagesDecoded = async(launch::async, decodeImages);
+		future<TTF_Font*> fontsOpened = async(launch::async, openFonts);
+		//Frees media of the workers and shuts SDL down when startup fails before loadMedia() takes them over
+		auto abortStartup = [&imagesDecoded, &fontsOpened]()
+		{
+			SDL_FreeSurface(imagesDecoded.get());
+			TTF_CloseFont(fontsOpened.get());
+			close();
+		};
+
+		if (!createWindow())
+		{
+			printf("Failed to initialize!\n");
+			abortStartup();
+			return false;
+		}
+		if (!levelsLoaded.get())
+		{
+			printf("Failed to load levels!\n");
+			abortStartup();
+			return false;
+		}
+		if (!loadLevel(gamestate.currentLevel))
+		{
+			printf("Failed to load level.\n");
+			abortStartup();
+			return false;
+		}
+		//Board is shown before media are ready
+		drawBoard();
+		SDL_RenderPresent(gameRend);
+		double firstFrame = startupTimeline.now();
+		startupTimeline.add("first frame", firstFrame, firstFrame);
+
+		SDL_Surface* ballSurface = imagesDecoded.get();
+		TTF_Font* font = fontsOpened.get();
+		if (!loadMedia(ballSurface, font))
+		{
+			printf("Failed to load media!\n");
+			close();
+			return false;
+		}
+		drawBoard();
+		levelBeginText(gamestate.currentLevel);
+		double ready = startupTimeline.now();
+		startupTimeline.add("level text shown", ready, ready);
+		startupTimeline.print();
+		//Flag defining whether the program is running or user quitted.
+		bool quit = false;
+		//Flag defining whether the game is paused or not.
+		bool pause = false;
+		//Event handling user's input.
+		SDL_Event e;
+		ball.isMoving = true;
+		if (soak.enabled) soak.begin();
+		if (threadedSimulation)
+		{
+			idleScheduler.begin();
+			runThreaded();
+			idleScheduler.report();
+			close();
+			return true;
+		}
+		idleScheduler.begin();
+		//Handles single event
+		auto handleEvent = [&quit](const SDL_Event& e)
+		{
+			if (e.type == SDL_QUIT)
+			{
+				quit = true;
+			}
+			if (e.type == SDL_KEYDOWN)
+			{
+				applyInput(commandForKey(e.key.keysym.sym));
+			}
+			if (idleScheduler.isSuspendEvent(e) && !autopilot.enabled) applyInput(InputCommand::Suspend);
+		};
+		while (!quit)
+		{
+			//Paused game changes only on input, so the loop sleeps until it comes
+			bool idle = gamestate.pause && !soak.enabled;
+			if (idle && eventWaiter.wait(e, idleScheduler.idleTimeout)) handleEvent(e);
+			while (SDL_PollEvent(&e) != 0) handleEvent(e);
+			if (autopilot.enabled) autopilot.update();
+			if (soak.enabled) soak.resumeIfPaused();
+			if (!gamestate.pause)
+			{
+				Uint64 frameStart = SDL_GetPerformanceCounter();
+				drawFrame();
+				double frameMs = secondsSince(frameStart) * 1000;
+				if (soak.enabled) soak.addFrame(frameMs);
+				adaptRenderScale(frameMs);
+			}
+			if (soak.enabled && !soak.update(gamestate.currentLevel, gamestate.points)) quit = true;
+			if (!gamestate.pause || soak.enabled)
+			{
+				SDL_Delay(15);
+				idleScheduler.countWakeup();
+			}
+		}
+		if (soak.enabled) soak.report(gamestate.currentLevel, gamestate.points);
+		idleScheduler.report();
+		close();
+		return true;
+	}
+
+};
+
+int main(int argc, char* argv[])
+{
+	ballgame::trackSdlAllocations();
+	bool benchmark = false;
+	bool workload = false;
+	string workloadReport;
+	string workloadBaseline;
+	unsigned long long headlessTicks = 0;
+	bool fastForward = false;
+	int batchGames = 0;
+	unsigned long long batchSteps = 0;
+	int batchThreads = max(1, static_cast<int>(thread::hardware_concurrency()));
+	bool batchTest = false;
+	int exitCode = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		//Records gameplay events to the given file, see telemetry_reader.
+		if (arg == "--telemetry" && i + 1 < argc) ballgame::startTelemetry(argv[++i]);
+		//Measures the game on generated boards instead of playing.
+		else if (arg == "--benchmark") benchmark = true;
+		//Plays the profiling workload: --workload [report file]
+		else if (arg == "--workload")
+		{
+			workload = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') workloadReport = argv[++i];
+		}
+		//Report of an earlier --workload run to compare with: --baseline <report file>
+		else if (arg == "--baseline" && i + 1 < argc) workloadBaseline = argv[++i];
+		//Plays given number of ticks without a window.
+		else if (arg == "--simulate" && i + 1 < argc) headlessTicks = stoull(argv[++i]);
+		//Steps many games in lockstep on worker threads: --batch <games> <steps> [threads]
+		else if (arg == "--batch" && i + 2 < argc)
+		{
+			batchGames = stoi(argv[++i]);
+			batchSteps = stoull(argv[++i]);
+			if (i + 1 < argc && argv[i + 1][0] != '-') batchThreads = stoi(argv[++i]);
+		}
+		//Checks that batch games recreated on the same object play like new ones.
+		else if (arg == "--batch-test") batchTest = true;
+		//Draws the scene at its own resolution stretched to the window: --render-scale <scale> [nearest|linear]
+		else if (arg == "--render-scale" && i + 1 < argc)
+		{
+			ballgame::resolution.enabled = true;
+			ballgame::resolution.maxScale = stof(argv[++i]);
+			if (i + 1 < argc && (string(argv[i + 1]) == "nearest" || string(argv[i + 1]) == "linear")) ballgame::resolution.linear = string(argv[++i]) == "linear";
+		}
+		//Frame time in ms above which the render scale drops, 0 keeps it fixed.
+		else if (arg == "--frame-budget" && i + 1 < argc) ballgame::resolution.budgetMs = stod(argv[++i]);
+		//Runs simulation and rendering on separate threads.
+		else if (arg == "--threaded") ballgame::threadedSimulation = true;
+		//Skips ticks without collisions in --simulate.
+		else if (arg == "--fast-forward") fastForward = true;
+		//Lets the autopilot steer the racket: --autopilot [skill 0-1]
+		else if (arg == "--autopilot")
+		{
+			ballgame::autopilot.enabled = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') ballgame::autopilot.skill = stod(argv[++i]);
+		}
+		//Plays all levels in a loop with the autopilot, reporting frame times and memory: --soak [minutes]
+		else if (arg == "--soak")
+		{
+			ballgame::soak.enabled = true;
+			ballgame::autopilot.enabled = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') ballgame::soak.durationMinutes = stod(argv[++i]);
+		}
+		//Writes generated level: --generate-level <file> <rows> <columns> <density> <seed> [rows per chunk]
+		else if (arg == "--generate-level" && i + 5 < argc)
+		{
+			ballgame::LevelGeneratorSettings settings;
+			string path = argv[++i];
+			settings.rows = stoi(argv[++i]);
+			settings.columns = stoi(argv[++i]);
+			settings.density = stod(argv[++i]);
+			settings.seed = stoul(argv[++i]);
+			if (i + 1 < argc && argv[i + 1][0] != '-') settings.chunkRows = stoi(argv[++i]);
+			return ballgame::generateLevelFile(settings, path) ? 0 : 1;
+		}
+	}
+	if (benchmark) ballgame::runBenchmark();
+	else if (workload) ballgame::runWorkload(workloadReport, workloadBaseline);
+	else if (headlessTicks > 0) ballgame::runHeadless(headlessTicks, fastForward);
+	else if (batchGames > 0) ballgame::runBatch(batchGames, batchSteps, batchThreads);
+	else if (batchTest) exitCode = ballgame::runBatchTest() ? 0 : 1;
+	else ballgame::run();
+	ballgame::stopTelemetry();
+	ballgame::printMemoryStats();
+	return exitCode;
 }
\ No newline at end of file
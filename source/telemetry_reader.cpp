@@ -0,0 +1,100 @@
+/**
+Converts binary telemetry file written by the game to CSV.
+Usage: telemetry_reader <telemetry.bin> [output.csv]
+Without output file the CSV is printed to standard output.
+The last column gives the number of ticks every record stands for, the weight of its values in per tick statistics:
+a ball_move record of a fast-forward run covers a whole skipped span.
+**/
+#include <stdio.h>
+#include "Telemetry.h"
+
+using namespace ballgame;
+
+//Returns readable name of the event type.
+const char* eventName(uint8_t type)
+{
+	switch (static_cast<TelemetryEvent>(type))
+	{
+	case TelemetryEvent::BallMove:
+		return "ball_move";
+	case TelemetryEvent::VMaxClamp:
+		return "vmax_clamp";
+	case TelemetryEvent::BlockHit:
+		return "block_hit";
+	case TelemetryEvent::LifeLost:
+		return "life_lost";
+	case TelemetryEvent::GameOver:
+		return "game_over";
+	}
+	return "unknown";
+}
+
+//Returns number of ticks given record stands for.
+int recordTicks(const TelemetryRecord& r)
+{
+	//Files of older builds left c of ball moves 0, and they were written every tick
+	if (static_cast<TelemetryEvent>(r.type) == TelemetryEvent::BallMove && r.c > 0) return r.c;
+	return 1;
+}
+
+//Closes the input and the output unless it is standard output.
+void closeFiles(FILE* in, FILE* out)
+{
+	fclose(in);
+	if (out != stdout) fclose(out);
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s <telemetry.bin> [output.csv]\n", argv[0]);
+		return 1;
+	}
+	FILE* in = fopen(argv[1], "rb");
+	if (in == NULL)
+	{
+		printf("Unable to open %s!\n", argv[1]);
+		return 1;
+	}
+	FILE* out = stdout;
+	if (argc > 2)
+	{
+		out = fopen(argv[2], "w");
+		if (out == NULL)
+		{
+			printf("Unable to create %s!\n", argv[2]);
+			fclose(in);
+			return 1;
+		}
+	}
+
+	uint32_t header[3];
+	if (fread(header, sizeof(header), 1, in) != 1 || header[0] != telemetryMagic)
+	{
+		printf("%s is not a telemetry file!\n", argv[1]);
+		closeFiles(in, out);
+		return 1;
+	}
+	if (header[1] != telemetryVersion || header[2] != sizeof(TelemetryRecord))
+	{
+		printf("Unsupported telemetry version %u!\n", header[1]);
+		closeFiles(in, out);
+		return 1;
+	}
+
+	fprintf(out, "tick,event,level,a,b,c,points,ticks\n");
+	TelemetryRecord records[1024];
+	size_t count;
+	while ((count = fread(records, sizeof(TelemetryRecord), 1024, in)) > 0)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			const TelemetryRecord& r = records[i];
+			fprintf(out, "%u,%s,%u,%d,%d,%d,%d,%d\n", r.tick, eventName(r.type), r.level, r.a, r.b, r.c, r.points, recordTicks(r));
+		}
+	}
+
+	closeFiles(in, out);
+	return 0;
+}